@@ -0,0 +1,505 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+#include <aa/frame_stats.h>
+#include <aa/gpu_profiler.h>
+#include <aa/image_metrics.h>
+#include <aa/jitter.h>
+#include <aa/smaa_modes.h>
+
+// AA methods, numbered the same way as the radio buttons in the Control Panel (currentAA)
+enum AAMethod {
+    AA_MSAA = 0,
+    AA_FXAA = 1,
+    AA_SMAA = 2,
+    AA_SMAA_CS = 3,     // SMAA through compute shaders
+    AA_NONE = 4
+};
+
+// SMAA and SMAA CS take the SMAA preset as their quality
+inline bool usesSMAAPreset(int method)
+{
+    return method == AA_SMAA || method == AA_SMAA_CS;
+}
+
+const char* const benchmarkSceneNames[] = { "Container", "Sponza", "Image" };
+const char* const benchmarkMethodNames[] = { "MSAA", "FXAA", "SMAA", "SMAACS", "NOAA" };
+const char* const benchmarkMSAANames[] = { "1X", "2X", "4X", "8X", "16X" };
+const char* const benchmarkSMAANames[] = { "LOW", "MEDIUM", "HIGH", "ULTRA" };
+
+// a single cell of the benchmark matrix
+struct BenchmarkConfig
+{
+    AAMethod method;
+    int msaaQuality;    // index into msaaSamples[]
+    int smaaQuality;    // index into smaaPresets[]
+    bool taa;
+    int scene = 0;      // index into benchmarkSceneNames[]
+    int viewpoint = 1;  // 1..3, see changeViewpoint()
+    int width = 1600;
+    int height = 900;
+    int jitterSequence = JITTER_T2X;    // TAA jitter, see jitter.h
+    int jitterSamples = 2;
+    int smaaMode = SMAA_MODE_1X;        // SMAA only, see smaa_modes.h
+    int smaaEdgeMethod = SMAA_EDGE_COLOR;   // SMAA only
+};
+
+// TAA jitter as written in the jitter column and the config names: T2X, HALTON8, R216, ...
+inline std::string benchmarkJitterName(const BenchmarkConfig& config)
+{
+    std::string name = jitterSequenceNames[config.jitterSequence];
+    if (config.jitterSequence == JITTER_HALTON || config.jitterSequence == JITTER_R2)
+        name += std::to_string(jitterSampleCount(config.jitterSequence, config.jitterSamples));
+    return name;
+}
+
+// method as written in the method column: SMAA with a mode other than 1x is SMAAT2X, SMAAS2X or SMAA4X
+inline std::string benchmarkMethodName(const BenchmarkConfig& config)
+{
+    std::string name = benchmarkMethodNames[config.method];
+    if (config.method == AA_SMAA && config.smaaMode != SMAA_MODE_1X)
+        name += smaaModeNames[config.smaaMode];
+    return name;
+}
+
+// settings for a whole benchmark run
+struct BenchmarkSettings
+{
+    int warmupFrames = 60;
+    int frames = 600;
+    std::string output = "benchmark.csv";
+    std::string histogramOutput = "benchmark_histogram.csv";
+    int referenceScale = 16;    // samples per pixel along x and y of the ground truth the measured frames are scored against, 0 skips it
+    std::vector<BenchmarkConfig> configs;
+};
+
+// name used in result.txt, matches the naming of the captures in Benchmarks/
+inline std::string benchmarkConfigName(const BenchmarkConfig& config)
+{
+    std::string name;
+    switch (config.method)
+    {
+    case AA_MSAA:
+        name = std::string("MSAA_") + benchmarkMSAANames[config.msaaQuality];
+        break;
+    case AA_FXAA:
+        name = "FXAA";
+        break;
+    case AA_SMAA:
+        name = benchmarkMethodName(config) + "_" + benchmarkSMAANames[config.smaaQuality];
+        break;
+    case AA_SMAA_CS:
+        name = std::string("SMAACS_") + benchmarkSMAANames[config.smaaQuality];
+        break;
+    default:
+        name = "NOAA";
+        break;
+    }
+    if (config.method == AA_SMAA && config.smaaEdgeMethod != SMAA_EDGE_COLOR)
+        name += std::string("_") + smaaEdgeMethodNames[config.smaaEdgeMethod];
+    if (config.taa)
+        name += "_TAA";
+    if (config.taa && (config.jitterSequence == JITTER_HALTON || config.jitterSequence == JITTER_R2))
+        name += "_" + benchmarkJitterName(config);
+
+    return name;
+}
+
+// every AA method with every quality level, with and without TAA
+inline std::vector<BenchmarkConfig> defaultBenchmarkMatrix()
+{
+    std::vector<BenchmarkConfig> configs;
+    configs.push_back({ AA_NONE, 0, 0, false });
+    for (int taa = 0; taa < 2; taa++)
+    {
+        for (int i = 0; i < 5; i++)
+            configs.push_back({ AA_MSAA, i, 0, taa == 1 });
+        configs.push_back({ AA_FXAA, 0, 0, taa == 1 });
+        for (int i = 0; i < 4; i++)
+            configs.push_back({ AA_SMAA, 0, i, taa == 1 });
+        for (int i = 0; i < 4; i++)
+            configs.push_back({ AA_SMAA_CS, 0, i, taa == 1 });
+    }
+
+    // TAA on its own over 8 and 16 jitter positions, to hold against MSAA 8X and 16X
+    for (int sequence = JITTER_HALTON; sequence <= JITTER_R2; sequence++)
+    {
+        for (int samples = 8; samples <= 16; samples *= 2)
+        {
+            BenchmarkConfig config = { AA_MSAA, 0, 0, true };
+            config.jitterSequence = sequence;
+            config.jitterSamples = samples;
+            configs.push_back(config);
+        }
+    }
+
+    // the SMAA modes at every preset, T2x and 4x need TAA
+    for (int i = 0; i < 4; i++)
+    {
+        for (int mode = SMAA_MODE_T2X; mode <= SMAA_MODE_4X; mode++)
+        {
+            BenchmarkConfig config = { AA_SMAA, 0, i, smaaModeTemporal(mode) };
+            config.jitterSequence = smaaModeJitter(mode);
+            config.smaaMode = mode;
+            configs.push_back(config);
+        }
+    }
+
+    // SMAA 1x with the other edge detection methods
+    for (int i = 0; i < 4; i++)
+    {
+        for (int method = 0; method < SMAA_EDGE_METHOD_COUNT; method++)
+        {
+            if (method == SMAA_EDGE_COLOR)
+                continue; // already in the matrix
+            BenchmarkConfig config = { AA_SMAA, 0, i, false };
+            config.smaaEdgeMethod = method;
+            configs.push_back(config);
+        }
+    }
+    return configs;
+}
+
+// matches a token against a name table; "*" selects every entry
+inline bool parseBenchmarkChoice(const std::string& token, const char* const* names, int count, std::vector<int>& out)
+{
+    out.clear();
+    for (int i = 0; i < count; i++)
+    {
+        std::string name = names[i];
+        if (token == "*" || token == name || token + "X" == name)
+            out.push_back(i);
+    }
+    return !out.empty();
+}
+
+// method column: one of benchmarkMethodNames or SMAA followed by the SMAA mode (SMAAT2X, SMAAS2X,
+// SMAA4X). "*" selects every method with SMAA in 1x.
+inline bool parseBenchmarkMethod(const std::string& token, std::vector<int>& out, int& smaaMode)
+{
+    smaaMode = SMAA_MODE_1X;
+    for (int mode = SMAA_MODE_T2X; mode <= SMAA_MODE_4X; mode++)
+    {
+        if (token == std::string("SMAA") + smaaModeNames[mode])
+        {
+            out.assign(1, AA_SMAA);
+            smaaMode = mode;
+            return true;
+        }
+    }
+    return parseBenchmarkChoice(token, benchmarkMethodNames, 5, out);
+}
+
+// a choice of the taa column
+struct BenchmarkTAAChoice
+{
+    bool taa;
+    int jitterSequence;
+    int jitterSamples;
+};
+
+// taa column: off | on (T2x) | T2X | HALTON:<samples> | R2:<samples> | * (off and on)
+inline bool parseBenchmarkTAA(const std::string& token, std::vector<BenchmarkTAAChoice>& out)
+{
+    out.clear();
+    if (token == "off" || token == "*")
+        out.push_back({ false, JITTER_T2X, 2 });
+    if (token == "on" || token == "*" || token == "T2X")
+        out.push_back({ true, JITTER_T2X, 2 });
+    if (!out.empty())
+        return true;
+
+    std::string sequence = token.substr(0, token.find(':'));
+    int samples = 0;
+    if (sequence.size() < token.size())
+        samples = std::atoi(token.c_str() + sequence.size() + 1);
+    if (samples < JITTER_MIN_SAMPLES || samples > JITTER_MAX_SAMPLES)
+        return false;
+
+    for (int i = JITTER_HALTON; i <= JITTER_R2; i++)
+    {
+        if (sequence == jitterSequenceNames[i])
+            out.push_back({ true, i, samples });
+    }
+    return !out.empty();
+}
+
+// reads a benchmark matrix from a text file. Each non-comment line is either a setting
+//   warmup <frames> | frames <frames> | output <file> | histogram <file> | reference <scale>
+// or a cell (any column can be "*" to sweep over all of its values)
+//   <scene> <viewpoint> <method> <quality> <taa> <width>x<height>
+// where quality is the MSAA sample count or the SMAA preset (SMAA, SMAACS), and "-" for FXAA and NOAA;
+// the SMAA preset can be followed by the edge detection, e.g. HIGH:DEPTH (SMAA only, COLOR if omitted),
+// and taa is off, on or the jitter of the TAA (see parseBenchmarkTAA). SMAAT2X and SMAA4X run with
+// TAA in the jitter of their mode, so their taa has to be on, and NOAA's has to be off; any other
+// taa is a bad line. A method of "*" only sweeps over the combinations that exist.
+// ------------------------------------------------------------------------
+inline bool loadBenchmarkSettings(const char* path, BenchmarkSettings& settings)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cout << "ERROR::BENCHMARK::FILE_NOT_SUCCESFULLY_READ: " << path << std::endl;
+        return false;
+    }
+
+    const char* const viewpointNames[] = { "1", "2", "3" };
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+        line = line.substr(0, line.find('#'));
+        std::istringstream stream(line);
+
+        std::string first;
+        if (!(stream >> first))
+            continue;
+
+        if (first == "warmup")
+        {
+            stream >> settings.warmupFrames;
+            continue;
+        }
+        if (first == "frames")
+        {
+            stream >> settings.frames;
+            continue;
+        }
+        if (first == "output")
+        {
+            stream >> settings.output;
+            continue;
+        }
+        if (first == "histogram")
+        {
+            stream >> settings.histogramOutput;
+            continue;
+        }
+        if (first == "reference")
+        {
+            stream >> settings.referenceScale;
+            continue;
+        }
+
+        std::string viewpoint, method, quality, taa, resolution;
+        stream >> viewpoint >> method >> quality >> taa >> resolution;
+
+        std::vector<int> scenes, viewpoints, methods, edgeMethods = { SMAA_EDGE_COLOR };
+        std::vector<BenchmarkTAAChoice> taas;
+        int smaaMode = SMAA_MODE_1X;
+
+        // quality[:edge detection]
+        std::string edgeMethod;
+        if (quality.find(':') != std::string::npos)
+        {
+            edgeMethod = quality.substr(quality.find(':') + 1);
+            quality = quality.substr(0, quality.find(':'));
+        }
+        int width = 0, height = 0;
+        char x = 0;
+        std::istringstream resolutionStream(resolution);
+        resolutionStream >> width >> x >> height;
+
+        if (!parseBenchmarkChoice(first, benchmarkSceneNames, 3, scenes)
+            || !parseBenchmarkChoice(viewpoint, viewpointNames, 3, viewpoints)
+            || !parseBenchmarkMethod(method, methods, smaaMode)
+            || !parseBenchmarkTAA(taa, taas)
+            || (!edgeMethod.empty() && !parseBenchmarkChoice(edgeMethod, smaaEdgeMethodNames, SMAA_EDGE_METHOD_COUNT, edgeMethods))
+            || (smaaModeTemporal(smaaMode) && taa != "on")
+            || (methods.size() == 1 && methods[0] == AA_NONE && taa != "off")
+            || x != 'x' || width <= 0 || height <= 0)
+        {
+            std::cout << "ERROR::BENCHMARK::BAD_LINE " << path << ":" << lineNumber << ": " << line << std::endl;
+            return false;
+        }
+
+        for (int s : scenes)
+            for (int v : viewpoints)
+                for (int m : methods)
+                {
+                    // the quality column only applies to MSAA and SMAA
+                    std::vector<int> qualities = { 0 };
+                    if ((m == AA_MSAA && !parseBenchmarkChoice(quality, benchmarkMSAANames, 5, qualities))
+                        || (usesSMAAPreset(m) && !parseBenchmarkChoice(quality, benchmarkSMAANames, 4, qualities))
+                        || (m != AA_SMAA && !edgeMethod.empty()))
+                    {
+                        std::cout << "ERROR::BENCHMARK::BAD_QUALITY " << path << ":" << lineNumber << ": " << quality << std::endl;
+                        return false;
+                    }
+
+                    for (int q : qualities)
+                        for (int e : edgeMethods)
+                            for (const BenchmarkTAAChoice& t : taas)
+                            {
+                                if (t.taa && m == AA_NONE)
+                                    continue; // TAA is only applied together with an AA method
+
+                                BenchmarkConfig config = { (AAMethod)m, m == AA_MSAA ? q : 0, usesSMAAPreset(m) ? q : 0, t.taa };
+                                config.jitterSequence = t.jitterSequence;
+                                config.jitterSamples = t.jitterSamples;
+                                config.smaaMode = smaaMode;
+                                config.smaaEdgeMethod = e;
+                                if (smaaModeTemporal(smaaMode))
+                                {
+                                    config.jitterSequence = smaaModeJitter(smaaMode);
+                                    config.jitterSamples = 2;
+                                }
+                                config.scene = s;
+                                config.viewpoint = v + 1;
+                                config.width = width;
+                                config.height = height;
+                                settings.configs.push_back(config);
+                            }
+                }
+    }
+    return true;
+}
+
+// one line of the benchmark output, written as CSV so it can be pasted into BenchResultChart.xlsx
+// ------------------------------------------------------------------------
+struct BenchmarkRecord
+{
+    BenchmarkConfig config;
+    int warmupFrames;
+    int frames;
+    double elapsed;     // seconds spent on the measured frames
+    FrameStats cpu;     // frame-to-frame time
+    FrameStats gpu;     // GPU time of the rendering of a frame
+    double passMs[GPU_PASS_COUNT];  // average GPU time of every pass, 0 if it did not run
+    bool qualityMeasured = false;
+    ImageQuality quality;           // average of the measured frames against the supersampled reference
+    int qualityFrames = 0;          // frames that were scored
+};
+
+inline void writeFrameStatsHeader(std::ostream& out, const char* prefix)
+{
+    const char* names[] = { "mean", "median", "p95", "p99", "p99.9", "max" };
+    for (const char* name : names)
+        out << ',' << prefix << '_' << name;
+}
+
+inline void writeFrameStats(std::ostream& out, const FrameStats& stats)
+{
+    out << ',' << stats.mean << ',' << stats.median << ',' << stats.p95
+        << ',' << stats.p99 << ',' << stats.p999 << ',' << stats.max;
+}
+
+inline void writeBenchmarkConfig(std::ostream& out, const BenchmarkConfig& config)
+{
+    out << benchmarkSceneNames[config.scene] << ','
+        << config.viewpoint << ','
+        << benchmarkMethodName(config) << ','
+        << (config.method == AA_MSAA ? benchmarkMSAANames[config.msaaQuality] : "-") << ','
+        << (usesSMAAPreset(config.method) ? benchmarkSMAANames[config.smaaQuality] : "-") << ','
+        << (config.method == AA_SMAA ? smaaEdgeMethodNames[config.smaaEdgeMethod] : "-") << ','
+        << (config.taa ? "on" : "off") << ','
+        << (config.taa ? benchmarkJitterName(config) : "-") << ','
+        << config.width << ',' << config.height;
+}
+
+inline void writeBenchmarkHeader(std::ostream& out)
+{
+    out << "scene,viewpoint,method,msaa,smaa,edge,taa,jitter,width,height,warmup,frames,total_ms,avg_ms,fps";
+    writeFrameStatsHeader(out, "cpu");
+    writeFrameStatsHeader(out, "gpu");
+    out << ",low1_fps";
+    for (int pass = 0; pass < GPU_PASS_COUNT; pass++)
+        out << ",gpu_" << gpuPassNames[pass] << "_ms";
+    out << ",psnr_db,ssim,edge_error,quality_frames";
+    out << std::endl;
+}
+
+inline void writeBenchmarkRecord(std::ostream& out, const BenchmarkRecord& record)
+{
+    writeBenchmarkConfig(out, record.config);
+    out << ',' << record.warmupFrames << ',' << record.frames << ','
+        << record.elapsed * 1000.0 << ','
+        << record.elapsed * 1000.0 / record.frames << ','
+        << record.frames / record.elapsed;
+    writeFrameStats(out, record.cpu);
+    writeFrameStats(out, record.gpu);
+    // 1% low: the frame rate the slowest 1% of the frames run at
+    out << ',' << (record.cpu.p99 > 0.0 ? 1000.0 / record.cpu.p99 : 0.0);
+    for (int pass = 0; pass < GPU_PASS_COUNT; pass++)
+        out << ',' << record.passMs[pass];
+    if (record.qualityMeasured)
+        out << ',' << record.quality.psnr << ',' << record.quality.ssim << ',' << record.quality.edgeError << ',' << record.qualityFrames;
+    else
+        out << ",-,-,-,0";
+    out << std::endl;
+}
+
+// human readable summary for result.txt
+// ------------------------------------------------------------------------
+inline void writeFrameStatsSummary(std::ostream& out, const char* clock, const FrameStats& stats)
+{
+    out << clock << " frame time (ms) : mean " << stats.mean << " / median " << stats.median
+        << " / p95 " << stats.p95 << " / p99 " << stats.p99 << " / p99.9 " << stats.p999
+        << " / max " << stats.max << " (" << stats.count << " frames)" << std::endl;
+    if (stats.p99 > 0.0)
+        out << clock << " 1% low : " << 1000.0 / stats.p99 << "FPS" << std::endl;
+
+    out << clock << " histogram :";
+    for (int bin = 0; bin < FRAME_HISTOGRAM_BINS; bin++)
+    {
+        if (stats.histogram[bin] == 0)
+            continue;
+        if (bin == FRAME_HISTOGRAM_BINS - 1)
+            out << " more:" << stats.histogram[bin];
+        else
+            out << " <" << frameHistogramUpperEdge(bin) << "ms:" << stats.histogram[bin];
+    }
+    out << std::endl;
+}
+
+inline void writeQualitySummary(std::ostream& out, const ImageQuality& quality, int scale, int frames)
+{
+    out << "Quality vs " << scale << "x" << scale << " supersampled : PSNR " << quality.psnr << "dB / SSIM " << quality.ssim
+        << " / edge error " << quality.edgeError << " (" << frames << " frames)" << std::endl;
+}
+
+inline void writeGpuPassSummary(std::ostream& out, const double* passMs)
+{
+    out << "GPU passes (ms) :";
+    for (int pass = 0; pass < GPU_PASS_COUNT; pass++)
+    {
+        if (passMs[pass] > 0.0)
+            out << " " << gpuPassNames[pass] << " " << passMs[pass];
+    }
+    out << std::endl;
+}
+
+// frame-time histograms, one line of bin counts per cell and per clock
+// ------------------------------------------------------------------------
+inline void writeBenchmarkHistogramHeader(std::ostream& out)
+{
+    out << "scene,viewpoint,method,msaa,smaa,edge,taa,jitter,width,height,clock";
+    for (int bin = 0; bin < FRAME_HISTOGRAM_BINS - 1; bin++)
+        out << ",<" << frameHistogramUpperEdge(bin) << "ms";
+    out << ",more" << std::endl;
+}
+
+inline void writeBenchmarkHistogram(std::ostream& out, const BenchmarkRecord& record)
+{
+    const FrameStats* stats[] = { &record.cpu, &record.gpu };
+    const char* clocks[] = { "cpu", "gpu" };
+    for (int i = 0; i < 2; i++)
+    {
+        writeBenchmarkConfig(out, record.config);
+        out << ',' << clocks[i];
+        for (int bin = 0; bin < FRAME_HISTOGRAM_BINS; bin++)
+            out << ',' << stats[i]->histogram[bin];
+        out << std::endl;
+    }
+}
+
+#endif
@@ -0,0 +1,141 @@
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// frame-time histogram: quarter-octave bins starting at 1/16 ms, the last bin collects everything above
+#define FRAME_HISTOGRAM_BINS 48
+
+inline double frameHistogramUpperEdge(int bin)
+{
+    return std::pow(2.0, bin / 4.0 - 4.0 + 0.25);
+}
+
+inline int frameHistogramBin(double ms)
+{
+    int bin = (int)std::floor((std::log2(std::max(ms, 1e-6)) + 4.0) * 4.0);
+    return std::min(std::max(bin, 0), FRAME_HISTOGRAM_BINS - 1);
+}
+
+// summary of the frame times of a run, in milliseconds
+struct FrameStats
+{
+    unsigned int count = 0;
+    double mean = 0.0;
+    double median = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+    double p999 = 0.0;
+    double max = 0.0;
+    unsigned int histogram[FRAME_HISTOGRAM_BINS] = {};
+};
+
+// Per-frame CPU and GPU times of the last frames. All storage is allocated up front, so
+// recording a frame never allocates. Times that are not known (yet) are stored as negative
+// values and left out of the statistics; GPU times typically arrive a few frames late.
+class FrameTimeRing
+{
+public:
+    explicit FrameTimeRing(unsigned int capacity) : cpu(capacity, -1.0), gpu(capacity, -1.0), scratch(capacity)
+    {
+        first = 0;
+        last = 0;
+        empty = true;
+    }
+
+    unsigned int capacity() const { return (unsigned int)cpu.size(); }
+
+    // forget everything before the given frame
+    void reset(unsigned int frame)
+    {
+        first = frame;
+        last = frame;
+        empty = true;
+    }
+
+    // call once at the start of every frame
+    void beginFrame(unsigned int frame)
+    {
+        cpu[frame % capacity()] = -1.0;
+        gpu[frame % capacity()] = -1.0;
+        last = frame;
+        empty = false;
+    }
+
+    void setCpu(unsigned int frame, double ms)
+    {
+        if (contains(frame))
+            cpu[frame % capacity()] = ms;
+    }
+
+    void setGpu(unsigned int frame, double ms)
+    {
+        if (contains(frame))
+            gpu[frame % capacity()] = ms;
+    }
+
+    // statistics over the last `frames` recorded frames (0 for all of them)
+    // ------------------------------------------------------------------------
+    FrameStats cpuStats(unsigned int frames = 0) { return stats(cpu, frames); }
+    FrameStats gpuStats(unsigned int frames = 0) { return stats(gpu, frames); }
+
+private:
+    std::vector<double> cpu;
+    std::vector<double> gpu;
+    std::vector<double> scratch;
+    unsigned int first;
+    unsigned int last;
+    bool empty;
+
+    bool contains(unsigned int frame) const
+    {
+        return !empty && frame >= first && frame <= last && last - frame < capacity();
+    }
+
+    FrameStats stats(const std::vector<double>& times, unsigned int frames)
+    {
+        FrameStats result;
+        if (empty)
+            return result;
+
+        unsigned int count = std::min(last - first + 1, capacity());
+        if (frames != 0)
+            count = std::min(count, frames);
+
+        // gather the known times of the window
+        double sum = 0.0;
+        unsigned int n = 0;
+        for (unsigned int frame = last + 1 - count; frame != last + 1; frame++)
+        {
+            double ms = times[frame % capacity()];
+            if (ms < 0.0)
+                continue;
+            scratch[n++] = ms;
+            sum += ms;
+            result.histogram[frameHistogramBin(ms)]++;
+        }
+        if (n == 0)
+            return result;
+
+        std::sort(scratch.begin(), scratch.begin() + n);
+
+        // nearest-rank percentiles
+        auto percentile = [&](double p) {
+            unsigned int rank = (unsigned int)std::ceil(p * n);
+            return scratch[std::max(rank, 1u) - 1];
+        };
+
+        result.count = n;
+        result.mean = sum / n;
+        result.median = percentile(0.5);
+        result.p95 = percentile(0.95);
+        result.p99 = percentile(0.99);
+        result.p999 = percentile(0.999);
+        result.max = scratch[n - 1];
+        return result;
+    }
+};
+
+#endif
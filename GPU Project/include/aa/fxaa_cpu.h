@@ -0,0 +1,575 @@
+#ifndef FXAA_CPU_H
+#define FXAA_CPU_H
+
+#include <aa/image_io.h>
+#include <aa/thread_pool.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// The SIMD paths are compiled where the compiler allows the instructions: MSVC always has the
+// intrinsics, GCC and Clang only with -msse4.1 / -mavx2. Which one runs is decided at runtime.
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#define FXAA_CPU_HAS_SSE4 1
+#define FXAA_CPU_HAS_AVX2 1
+#else
+#if defined(__SSE4_1__)
+#define FXAA_CPU_HAS_SSE4 1
+#endif
+#if defined(__AVX2__)
+#define FXAA_CPU_HAS_AVX2 1
+#endif
+#endif
+#ifdef FXAA_CPU_HAS_SSE4
+#include <smmintrin.h>
+#endif
+#ifdef FXAA_CPU_HAS_AVX2
+#include <immintrin.h>
+#endif
+
+// FXAA 3.11 quality on the CPU, the same algorithm as fxaa_demo.fs: preset 12, green as luma,
+// clamp to edge. Texture reads are emulated with bilinear filtering in float, positions are in
+// pixels instead of texcoords. The result matches the shader up to filtering precision, a few
+// pixels on the border of a search may land on the other side of a threshold.
+
+// the FxaaPixelShader arguments of fxaa_demo.fs
+struct FxaaCpuSettings
+{
+    float subpix = 0.75f;
+    float edgeThreshold = 0.166f;
+    float edgeThresholdMin = 0.0833f;
+};
+
+enum FxaaCpuPath {
+    FXAA_CPU_SCALAR = 0,
+    FXAA_CPU_SSE4 = 1,      // 4 pixels of a row at once
+    FXAA_CPU_AVX2 = 2       // 8 pixels of a row at once, gathers for the search
+};
+
+const char* const fxaaCpuPathNames[] = { "SCALAR", "SSE4", "AVX2" };
+
+inline bool fxaaCpuPathSupported(int path)
+{
+    switch (path)
+    {
+    case FXAA_CPU_SCALAR:
+        return true;
+#ifdef FXAA_CPU_HAS_SSE4
+    case FXAA_CPU_SSE4:
+#ifdef _MSC_VER
+    {
+        int info[4];
+        __cpuid(info, 1);
+        return (info[2] & (1 << 19)) != 0;
+    }
+#else
+        return __builtin_cpu_supports("sse4.1");
+#endif
+#endif
+#ifdef FXAA_CPU_HAS_AVX2
+    case FXAA_CPU_AVX2:
+#ifdef _MSC_VER
+    {
+        // the OS has to save the ymm registers as well
+        int info[4];
+        __cpuid(info, 1);
+        bool avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+        __cpuidex(info, 7, 0);
+        return avx && (info[1] & (1 << 5)) != 0;
+    }
+#else
+        return __builtin_cpu_supports("avx2");
+#endif
+#endif
+    default:
+        return false;
+    }
+}
+
+// by name as in fxaaCpuPathNames, in any case, -1 if there is no such path
+inline int parseFxaaCpuPath(std::string name)
+{
+    std::transform(name.begin(), name.end(), name.begin(), ::toupper);
+    for (int path = FXAA_CPU_SCALAR; path <= FXAA_CPU_AVX2; path++)
+    {
+        if (name == fxaaCpuPathNames[path])
+            return path;
+    }
+    return -1;
+}
+
+inline int fxaaCpuBestPath()
+{
+    if (fxaaCpuPathSupported(FXAA_CPU_AVX2))
+        return FXAA_CPU_AVX2;
+    if (fxaaCpuPathSupported(FXAA_CPU_SSE4))
+        return FXAA_CPU_SSE4;
+    return FXAA_CPU_SCALAR;
+}
+
+// an image being processed, shared by the tiles
+struct FxaaCpuFrame
+{
+    const RGBAImage* source;
+    RGBAImage* target;
+    std::vector<float> luma;    // green / 255, with a border of one replicated pixel
+    int stride;                 // width + 2
+    FxaaCpuSettings settings;
+};
+
+// Lane types: F holds one float per pixel, M one flag per pixel. The kernel below is written
+// once against these, so that every path runs the exact same operations in the same order.
+// ------------------------------------------------------------------------
+struct FxaaF1
+{
+    static const int lanes = 1;
+    float v;
+    FxaaF1(float v) : v(v) {}
+    static FxaaF1 load(const float* p) { return *p; }
+    static FxaaF1 ramp(float first) { return first; }
+    void store(float* p) const { *p = v; }
+};
+
+struct FxaaM1
+{
+    bool v;
+    FxaaM1(bool v) : v(v) {}
+};
+
+inline FxaaF1 operator+(FxaaF1 a, FxaaF1 b) { return a.v + b.v; }
+inline FxaaF1 operator-(FxaaF1 a, FxaaF1 b) { return a.v - b.v; }
+inline FxaaF1 operator*(FxaaF1 a, FxaaF1 b) { return a.v * b.v; }
+inline FxaaF1 operator/(FxaaF1 a, FxaaF1 b) { return a.v / b.v; }
+inline FxaaM1 operator<(FxaaF1 a, FxaaF1 b) { return a.v < b.v; }
+inline FxaaM1 operator>=(FxaaF1 a, FxaaF1 b) { return a.v >= b.v; }
+inline FxaaM1 operator&(FxaaM1 a, FxaaM1 b) { return a.v && b.v; }
+inline FxaaM1 operator|(FxaaM1 a, FxaaM1 b) { return a.v || b.v; }
+inline FxaaM1 operator!=(FxaaM1 a, FxaaM1 b) { return a.v != b.v; }
+inline FxaaM1 operator!(FxaaM1 a) { return !a.v; }
+inline FxaaF1 fxaaMin(FxaaF1 a, FxaaF1 b) { return std::min(a.v, b.v); }
+inline FxaaF1 fxaaMax(FxaaF1 a, FxaaF1 b) { return std::max(a.v, b.v); }
+inline FxaaF1 fxaaAbs(FxaaF1 a) { return std::fabs(a.v); }
+inline FxaaF1 fxaaFloor(FxaaF1 a) { return std::floor(a.v); }
+inline FxaaF1 fxaaSelect(FxaaM1 m, FxaaF1 a, FxaaF1 b) { return m.v ? a.v : b.v; }
+inline int fxaaMaskBits(FxaaM1 m) { return m.v ? 1 : 0; }
+
+// base[row * stride + col], row and col hold whole numbers
+inline FxaaF1 fxaaGather(const float* base, int stride, FxaaF1 row, FxaaF1 col)
+{
+    return base[(int)row.v * stride + (int)col.v];
+}
+
+#ifdef FXAA_CPU_HAS_SSE4
+struct FxaaF4
+{
+    static const int lanes = 4;
+    __m128 v;
+    FxaaF4(__m128 v) : v(v) {}
+    FxaaF4(float s) : v(_mm_set1_ps(s)) {}
+    static FxaaF4 load(const float* p) { return _mm_loadu_ps(p); }
+    static FxaaF4 ramp(float first) { return _mm_setr_ps(first, first + 1.0f, first + 2.0f, first + 3.0f); }
+    void store(float* p) const { _mm_storeu_ps(p, v); }
+};
+
+struct FxaaM4
+{
+    __m128 v;
+    FxaaM4(__m128 v) : v(v) {}
+};
+
+inline FxaaF4 operator+(FxaaF4 a, FxaaF4 b) { return _mm_add_ps(a.v, b.v); }
+inline FxaaF4 operator-(FxaaF4 a, FxaaF4 b) { return _mm_sub_ps(a.v, b.v); }
+inline FxaaF4 operator*(FxaaF4 a, FxaaF4 b) { return _mm_mul_ps(a.v, b.v); }
+inline FxaaF4 operator/(FxaaF4 a, FxaaF4 b) { return _mm_div_ps(a.v, b.v); }
+inline FxaaM4 operator<(FxaaF4 a, FxaaF4 b) { return _mm_cmplt_ps(a.v, b.v); }
+inline FxaaM4 operator>=(FxaaF4 a, FxaaF4 b) { return _mm_cmpge_ps(a.v, b.v); }
+inline FxaaM4 operator&(FxaaM4 a, FxaaM4 b) { return _mm_and_ps(a.v, b.v); }
+inline FxaaM4 operator|(FxaaM4 a, FxaaM4 b) { return _mm_or_ps(a.v, b.v); }
+inline FxaaM4 operator!=(FxaaM4 a, FxaaM4 b) { return _mm_xor_ps(a.v, b.v); }
+inline FxaaM4 operator!(FxaaM4 a) { return _mm_xor_ps(a.v, _mm_castsi128_ps(_mm_set1_epi32(-1))); }
+inline FxaaF4 fxaaMin(FxaaF4 a, FxaaF4 b) { return _mm_min_ps(a.v, b.v); }
+inline FxaaF4 fxaaMax(FxaaF4 a, FxaaF4 b) { return _mm_max_ps(a.v, b.v); }
+inline FxaaF4 fxaaAbs(FxaaF4 a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v); }
+inline FxaaF4 fxaaFloor(FxaaF4 a) { return _mm_floor_ps(a.v); }
+inline FxaaF4 fxaaSelect(FxaaM4 m, FxaaF4 a, FxaaF4 b) { return _mm_blendv_ps(b.v, a.v, m.v); }
+inline int fxaaMaskBits(FxaaM4 m) { return _mm_movemask_ps(m.v); }
+
+inline FxaaF4 fxaaGather(const float* base, int stride, FxaaF4 row, FxaaF4 col)
+{
+    __m128i index = _mm_add_epi32(_mm_mullo_epi32(_mm_cvttps_epi32(row.v), _mm_set1_epi32(stride)), _mm_cvttps_epi32(col.v));
+    alignas(16) int i[4];
+    _mm_store_si128((__m128i*)i, index);
+    return _mm_setr_ps(base[i[0]], base[i[1]], base[i[2]], base[i[3]]);
+}
+#endif
+
+#ifdef FXAA_CPU_HAS_AVX2
+struct FxaaF8
+{
+    static const int lanes = 8;
+    __m256 v;
+    FxaaF8(__m256 v) : v(v) {}
+    FxaaF8(float s) : v(_mm256_set1_ps(s)) {}
+    static FxaaF8 load(const float* p) { return _mm256_loadu_ps(p); }
+    static FxaaF8 ramp(float first) { return _mm256_add_ps(_mm256_set1_ps(first), _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f)); }
+    void store(float* p) const { _mm256_storeu_ps(p, v); }
+};
+
+struct FxaaM8
+{
+    __m256 v;
+    FxaaM8(__m256 v) : v(v) {}
+};
+
+inline FxaaF8 operator+(FxaaF8 a, FxaaF8 b) { return _mm256_add_ps(a.v, b.v); }
+inline FxaaF8 operator-(FxaaF8 a, FxaaF8 b) { return _mm256_sub_ps(a.v, b.v); }
+inline FxaaF8 operator*(FxaaF8 a, FxaaF8 b) { return _mm256_mul_ps(a.v, b.v); }
+inline FxaaF8 operator/(FxaaF8 a, FxaaF8 b) { return _mm256_div_ps(a.v, b.v); }
+inline FxaaM8 operator<(FxaaF8 a, FxaaF8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ); }
+inline FxaaM8 operator>=(FxaaF8 a, FxaaF8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ); }
+inline FxaaM8 operator&(FxaaM8 a, FxaaM8 b) { return _mm256_and_ps(a.v, b.v); }
+inline FxaaM8 operator|(FxaaM8 a, FxaaM8 b) { return _mm256_or_ps(a.v, b.v); }
+inline FxaaM8 operator!=(FxaaM8 a, FxaaM8 b) { return _mm256_xor_ps(a.v, b.v); }
+inline FxaaM8 operator!(FxaaM8 a) { return _mm256_xor_ps(a.v, _mm256_castsi256_ps(_mm256_set1_epi32(-1))); }
+inline FxaaF8 fxaaMin(FxaaF8 a, FxaaF8 b) { return _mm256_min_ps(a.v, b.v); }
+inline FxaaF8 fxaaMax(FxaaF8 a, FxaaF8 b) { return _mm256_max_ps(a.v, b.v); }
+inline FxaaF8 fxaaAbs(FxaaF8 a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v); }
+inline FxaaF8 fxaaFloor(FxaaF8 a) { return _mm256_floor_ps(a.v); }
+inline FxaaF8 fxaaSelect(FxaaM8 m, FxaaF8 a, FxaaF8 b) { return _mm256_blendv_ps(b.v, a.v, m.v); }
+inline int fxaaMaskBits(FxaaM8 m) { return _mm256_movemask_ps(m.v); }
+
+inline FxaaF8 fxaaGather(const float* base, int stride, FxaaF8 row, FxaaF8 col)
+{
+    __m256i index = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_cvttps_epi32(row.v), _mm256_set1_epi32(stride)), _mm256_cvttps_epi32(col.v));
+    return _mm256_i32gather_ps(base, index, 4);
+}
+#endif
+
+inline FxaaF1 fxaaSat(FxaaF1 a) { return fxaaMin(fxaaMax(a, 0.0f), 1.0f); }
+#ifdef FXAA_CPU_HAS_SSE4
+inline FxaaF4 fxaaSat(FxaaF4 a) { return fxaaMin(fxaaMax(a, 0.0f), 1.0f); }
+#endif
+#ifdef FXAA_CPU_HAS_AVX2
+inline FxaaF8 fxaaSat(FxaaF8 a) { return fxaaMin(fxaaMax(a, 0.0f), 1.0f); }
+#endif
+
+// bilinear luma at (x, y) in pixels, clamped to the edge like the colorTex sampler
+// ------------------------------------------------------------------------
+template <class F>
+inline F fxaaCpuLuma(const FxaaCpuFrame& frame, F x, F y)
+{
+    F u = x - 0.5f;
+    F v = y - 0.5f;
+    F u0 = fxaaFloor(u);
+    F v0 = fxaaFloor(v);
+    F fx = u - u0;
+    F fy = v - v0;
+
+    // +1 for the border of the luma plane
+    F maxX = (float)(frame.source->width - 1);
+    F maxY = (float)(frame.source->height - 1);
+    F col0 = fxaaMin(fxaaMax(u0, 0.0f), maxX) + 1.0f;
+    F col1 = fxaaMin(fxaaMax(u0 + 1.0f, 0.0f), maxX) + 1.0f;
+    F row0 = fxaaMin(fxaaMax(v0, 0.0f), maxY) + 1.0f;
+    F row1 = fxaaMin(fxaaMax(v0 + 1.0f, 0.0f), maxY) + 1.0f;
+
+    const float* luma = frame.luma.data();
+    F a = fxaaGather(luma, frame.stride, row0, col0);
+    F b = fxaaGather(luma, frame.stride, row0, col1);
+    F c = fxaaGather(luma, frame.stride, row1, col0);
+    F d = fxaaGather(luma, frame.stride, row1, col1);
+    F top = a + (b - a) * fx;
+    F bottom = c + (d - c) * fx;
+    return top + (bottom - top) * fy;
+}
+
+// the final texture read of the shader, one pixel at a time
+inline void fxaaCpuColor(const FxaaCpuFrame& frame, float x, float y, unsigned char* pixel)
+{
+    const RGBAImage& source = *frame.source;
+    float u = x - 0.5f;
+    float v = y - 0.5f;
+    float u0 = std::floor(u);
+    float v0 = std::floor(v);
+    float fx = u - u0;
+    float fy = v - v0;
+
+    int col0 = std::min(std::max((int)u0, 0), source.width - 1);
+    int col1 = std::min(std::max((int)u0 + 1, 0), source.width - 1);
+    int row0 = std::min(std::max((int)v0, 0), source.height - 1);
+    int row1 = std::min(std::max((int)v0 + 1, 0), source.height - 1);
+
+    const unsigned char* a = source.row(row0) + col0 * 4;
+    const unsigned char* b = source.row(row0) + col1 * 4;
+    const unsigned char* c = source.row(row1) + col0 * 4;
+    const unsigned char* d = source.row(row1) + col1 * 4;
+    for (int i = 0; i < 3; i++)
+    {
+        float top = a[i] + (b[i] - a[i]) * fx;
+        float bottom = c[i] + (d[i] - c[i]) * fx;
+        pixel[i] = (unsigned char)(top + (bottom - top) * fy + 0.5f);
+    }
+    pixel[3] = 255; // fxaa_demo.fs clears alpha to 1
+}
+
+// FxaaPixelShader for F::lanes consecutive pixels of row y starting at x, see FXAA.glsl for the
+// commented original. The branches on a single pixel become selects; the search stops once
+// every lane is done.
+// ------------------------------------------------------------------------
+template <class F, class M>
+inline void fxaaCpuPixels(const FxaaCpuFrame& frame, int x, int y)
+{
+    const FxaaCpuSettings& settings = frame.settings;
+    const int stride = frame.stride;
+    const float* center = frame.luma.data() + (size_t)(y + 1) * stride + x + 1;
+    const unsigned char* source = frame.source->row(y) + x * 4;
+    unsigned char* target = frame.target->row(y) + x * 4;
+
+    F lumaM = F::load(center);
+    F lumaS = F::load(center + stride);
+    F lumaE = F::load(center + 1);
+    F lumaN = F::load(center - stride);
+    F lumaW = F::load(center - 1);
+
+    F maxSM = fxaaMax(lumaS, lumaM);
+    F minSM = fxaaMin(lumaS, lumaM);
+    F maxESM = fxaaMax(lumaE, maxSM);
+    F minESM = fxaaMin(lumaE, minSM);
+    F maxWN = fxaaMax(lumaN, lumaW);
+    F minWN = fxaaMin(lumaN, lumaW);
+    F rangeMax = fxaaMax(maxWN, maxESM);
+    F rangeMin = fxaaMin(minWN, minESM);
+    F rangeMaxScaled = rangeMax * settings.edgeThreshold;
+    F range = rangeMax - rangeMin;
+    F rangeMaxClamped = fxaaMax(settings.edgeThresholdMin, rangeMaxScaled);
+    M earlyExit = range < rangeMaxClamped;
+
+    int exitBits = fxaaMaskBits(earlyExit);
+    if (exitBits == (1 << F::lanes) - 1)
+    {
+        std::memcpy(target, source, F::lanes * 4);
+        for (int i = 0; i < F::lanes; i++)
+            target[i * 4 + 3] = 255;
+        return;
+    }
+
+    F lumaNW = F::load(center - stride - 1);
+    F lumaSE = F::load(center + stride + 1);
+    F lumaNE = F::load(center - stride + 1);
+    F lumaSW = F::load(center + stride - 1);
+
+    F lumaNS = lumaN + lumaS;
+    F lumaWE = lumaW + lumaE;
+    F subpixRcpRange = F(1.0f) / range;
+    F subpixNSWE = lumaNS + lumaWE;
+    F edgeHorz1 = lumaM * -2.0f + lumaNS;
+    F edgeVert1 = lumaM * -2.0f + lumaWE;
+
+    F lumaNESE = lumaNE + lumaSE;
+    F lumaNWNE = lumaNW + lumaNE;
+    F edgeHorz2 = lumaE * -2.0f + lumaNESE;
+    F edgeVert2 = lumaN * -2.0f + lumaNWNE;
+
+    F lumaNWSW = lumaNW + lumaSW;
+    F lumaSWSE = lumaSW + lumaSE;
+    F edgeHorz4 = fxaaAbs(edgeHorz1) * 2.0f + fxaaAbs(edgeHorz2);
+    F edgeVert4 = fxaaAbs(edgeVert1) * 2.0f + fxaaAbs(edgeVert2);
+    F edgeHorz3 = lumaW * -2.0f + lumaNWSW;
+    F edgeVert3 = lumaS * -2.0f + lumaSWSE;
+    F edgeHorz = fxaaAbs(edgeHorz3) + edgeHorz4;
+    F edgeVert = fxaaAbs(edgeVert3) + edgeVert4;
+
+    F subpixNWSWNESE = lumaNWSW + lumaNESE;
+    M horzSpan = edgeHorz >= edgeVert;
+    F subpixA = subpixNSWE * 2.0f + subpixNWSWNESE;
+
+    lumaN = fxaaSelect(horzSpan, lumaN, lumaW);
+    lumaS = fxaaSelect(horzSpan, lumaS, lumaE);
+    F subpixB = subpixA * (1.0f / 12.0f) - lumaM;
+
+    F gradientN = lumaN - lumaM;
+    F gradientS = lumaS - lumaM;
+    F lumaNN = lumaN + lumaM;
+    F lumaSS = lumaS + lumaM;
+    M pairN = fxaaAbs(gradientN) >= fxaaAbs(gradientS);
+    F gradient = fxaaMax(fxaaAbs(gradientN), fxaaAbs(gradientS));
+    F lengthSign = fxaaSelect(pairN, -1.0f, 1.0f);    // a pixel is the frame unit here
+    F subpixC = fxaaSat(fxaaAbs(subpixB) * subpixRcpRange);
+
+    F posMX = F::ramp(x + 0.5f);
+    F posMY = y + 0.5f;
+    F offNPX = fxaaSelect(horzSpan, 1.0f, 0.0f);
+    F offNPY = fxaaSelect(horzSpan, 0.0f, 1.0f);
+    F posBX = fxaaSelect(horzSpan, posMX, posMX + lengthSign * 0.5f);
+    F posBY = fxaaSelect(horzSpan, posMY + lengthSign * 0.5f, posMY);
+
+    F posNX = posBX - offNPX;   // FXAA_QUALITY__P0 is 1.0
+    F posNY = posBY - offNPY;
+    F posPX = posBX + offNPX;
+    F posPY = posBY + offNPY;
+    F subpixD = subpixC * -2.0f + 3.0f;
+    F lumaEndN = fxaaCpuLuma(frame, posNX, posNY);
+    F subpixE = subpixC * subpixC;
+    F lumaEndP = fxaaCpuLuma(frame, posPX, posPY);
+
+    lumaNN = fxaaSelect(pairN, lumaNN, lumaSS);
+    F gradientScaled = gradient * 0.25f;
+    F lumaMM = lumaM - lumaNN * 0.5f;
+    F subpixF = subpixD * subpixE;
+    M lumaMLTZero = lumaMM < 0.0f;
+
+    // pixels that exited early count as done, so they never keep the search going
+    lumaEndN = lumaEndN - lumaNN * 0.5f;
+    lumaEndP = lumaEndP - lumaNN * 0.5f;
+    M doneN = (fxaaAbs(lumaEndN) >= gradientScaled) | earlyExit;
+    M doneP = (fxaaAbs(lumaEndP) >= gradientScaled) | earlyExit;
+    posNX = fxaaSelect(doneN, posNX, posNX - offNPX * 1.5f);   // FXAA_QUALITY__P1
+    posNY = fxaaSelect(doneN, posNY, posNY - offNPY * 1.5f);
+    posPX = fxaaSelect(doneP, posPX, posPX + offNPX * 1.5f);
+    posPY = fxaaSelect(doneP, posPY, posPY + offNPY * 1.5f);
+
+    // FXAA_QUALITY__P2 to P4
+    const float steps[3] = { 2.0f, 4.0f, 12.0f };
+    for (int i = 0; i < 3 && fxaaMaskBits(doneN & doneP) != (1 << F::lanes) - 1; i++)
+    {
+        lumaEndN = fxaaSelect(doneN, lumaEndN, fxaaCpuLuma(frame, posNX, posNY) - lumaNN * 0.5f);
+        lumaEndP = fxaaSelect(doneP, lumaEndP, fxaaCpuLuma(frame, posPX, posPY) - lumaNN * 0.5f);
+        doneN = (fxaaAbs(lumaEndN) >= gradientScaled) | earlyExit;
+        doneP = (fxaaAbs(lumaEndP) >= gradientScaled) | earlyExit;
+        posNX = fxaaSelect(doneN, posNX, posNX - offNPX * steps[i]);
+        posNY = fxaaSelect(doneN, posNY, posNY - offNPY * steps[i]);
+        posPX = fxaaSelect(doneP, posPX, posPX + offNPX * steps[i]);
+        posPY = fxaaSelect(doneP, posPY, posPY + offNPY * steps[i]);
+    }
+
+    F dstN = fxaaSelect(horzSpan, posMX - posNX, posMY - posNY);
+    F dstP = fxaaSelect(horzSpan, posPX - posMX, posPY - posMY);
+
+    M goodSpanN = (lumaEndN < 0.0f) != lumaMLTZero;
+    F spanLength = dstP + dstN;
+    M goodSpanP = (lumaEndP < 0.0f) != lumaMLTZero;
+    F spanLengthRcp = F(1.0f) / spanLength;
+
+    M directionN = dstN < dstP;
+    F dst = fxaaMin(dstN, dstP);
+    F subpixG = subpixF * subpixF;
+    F pixelOffset = dst * (F(0.0f) - spanLengthRcp) + 0.5f;
+    F subpixH = subpixG * settings.subpix;
+
+    F pixelOffsetGood = fxaaSelect(directionN, fxaaSelect(goodSpanN, pixelOffset, 0.0f), fxaaSelect(goodSpanP, pixelOffset, 0.0f));
+    F pixelOffsetSubpix = fxaaMax(pixelOffsetGood, subpixH);
+    posMX = fxaaSelect(horzSpan, posMX, posMX + pixelOffsetSubpix * lengthSign);
+    posMY = fxaaSelect(horzSpan, posMY + pixelOffsetSubpix * lengthSign, posMY);
+
+    float finalX[F::lanes];
+    float finalY[F::lanes];
+    posMX.store(finalX);
+    posMY.store(finalY);
+    for (int i = 0; i < F::lanes; i++)
+    {
+        if (exitBits & (1 << i))
+        {
+            std::memcpy(target + i * 4, source + i * 4, 3);
+            target[i * 4 + 3] = 255;
+        }
+        else
+            fxaaCpuColor(frame, finalX[i], finalY[i], target + i * 4);
+    }
+}
+
+// the pixels [x0, x1) x [y0, y1), the row ends that do not fill a vector go one at a time
+template <class F, class M>
+inline void fxaaCpuTile(const FxaaCpuFrame& frame, int x0, int y0, int x1, int y1)
+{
+    for (int y = y0; y < y1; y++)
+    {
+        int x = x0;
+        for (; x + F::lanes <= x1; x += F::lanes)
+            fxaaCpuPixels<F, M>(frame, x, y);
+        for (; x < x1; x++)
+            fxaaCpuPixels<FxaaF1, FxaaM1>(frame, x, y);
+    }
+}
+
+// Runs FXAA on source into target, which is resized to match. The image is cut into tiles of
+// tileSize x tileSize pixels run as jobs on the pool, or on the calling thread without one.
+// Falls back to the best supported path if the given one is not available. Returns the path
+// that ran.
+// ------------------------------------------------------------------------
+inline int fxaaCpu(const RGBAImage& source, RGBAImage& target, int path = fxaaCpuBestPath(),
+    ThreadPool* pool = &sharedThreadPool(), const FxaaCpuSettings& settings = FxaaCpuSettings(), int tileSize = 64)
+{
+    if (!fxaaCpuPathSupported(path))
+        path = fxaaCpuBestPath();
+
+    target.resize(source.width, source.height);
+    if (source.width == 0 || source.height == 0)
+        return path;
+
+    FxaaCpuFrame frame;
+    frame.source = &source;
+    frame.target = &target;
+    frame.stride = source.width + 2;
+    frame.settings = settings;
+    frame.luma.resize((size_t)frame.stride * (source.height + 2));
+    for (int y = -1; y <= source.height; y++)
+    {
+        const unsigned char* row = source.row(std::min(std::max(y, 0), source.height - 1));
+        float* luma = frame.luma.data() + (size_t)(y + 1) * frame.stride;
+        for (int x = -1; x <= source.width; x++)
+            luma[x + 1] = row[std::min(std::max(x, 0), source.width - 1) * 4 + 1] * (1.0f / 255.0f);
+    }
+
+    void (*tile)(const FxaaCpuFrame&, int, int, int, int) = fxaaCpuTile<FxaaF1, FxaaM1>;
+#ifdef FXAA_CPU_HAS_SSE4
+    if (path == FXAA_CPU_SSE4)
+        tile = fxaaCpuTile<FxaaF4, FxaaM4>;
+#endif
+#ifdef FXAA_CPU_HAS_AVX2
+    if (path == FXAA_CPU_AVX2)
+        tile = fxaaCpuTile<FxaaF8, FxaaM8>;
+#endif
+
+    tileSize = std::max(tileSize, 8);
+    if (pool == NULL)
+    {
+        tile(frame, 0, 0, source.width, source.height);
+        return path;
+    }
+
+    // waits for its own tiles only, other users of the pool may have jobs in flight
+    std::mutex mutex;
+    std::condition_variable tilesDone;
+    int remaining = 0;
+    for (int y = 0; y < source.height; y += tileSize)
+    {
+        for (int x = 0; x < source.width; x += tileSize)
+        {
+            int x1 = std::min(x + tileSize, source.width);
+            int y1 = std::min(y + tileSize, source.height);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                remaining++;
+            }
+            pool->submit([&, tile, x, y, x1, y1] {
+                tile(frame, x, y, x1, y1);
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--remaining == 0)
+                    tilesDone.notify_all();
+            });
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    tilesDone.wait(lock, [&] { return remaining == 0; });
+    return path;
+}
+
+#endif
@@ -0,0 +1,133 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include <aa/gpu_timer.h>
+
+// post-processing passes that are timed on the GPU
+enum GpuPass {
+    PASS_SCENE,
+    PASS_MSAA_RESOLVE,
+    PASS_FXAA,
+    PASS_SMAA_SEPARATE,
+    PASS_SMAA_EDGE,
+    PASS_SMAA_WEIGHT,
+    PASS_SMAA_BLEND,
+    PASS_TAA_RESOLVE,
+    PASS_FXAA_TAA,      // FXAA and the TAA resolve fused into one pass
+    GPU_PASS_COUNT
+};
+
+const char* const gpuPassNames[GPU_PASS_COUNT] = {
+    "scene",
+    "msaa_resolve",
+    "fxaa",
+    "smaa_separate",
+    "smaa_edge",
+    "smaa_weight",
+    "smaa_blend",
+    "taa_resolve",
+    "fxaa_taa"
+};
+
+// Times every pass of a frame with its own GpuTimer. Results arrive a few frames late and
+// are kept both as a smoothed value for display and as an average over a measurement
+// window for the benchmark. Passes that do not run in a frame simply are not timed.
+class GpuProfiler
+{
+public:
+    GpuProfiler()
+    {
+        frame = 0;
+        windowStart = 0;
+        for (int i = 0; i < GPU_PASS_COUNT; i++)
+        {
+            smoothed[i] = 0.0;
+            sum[i] = 0.0;
+            count[i] = 0;
+            lastFrame[i] = 0;
+            seen[i] = false;
+        }
+    }
+
+    void init()
+    {
+        for (int i = 0; i < GPU_PASS_COUNT; i++)
+            timers[i].init();
+    }
+
+    void release()
+    {
+        for (int i = 0; i < GPU_PASS_COUNT; i++)
+            timers[i].release();
+    }
+
+    // call once at the start of every frame, picks up the results that are ready
+    void beginFrame(unsigned int frame)
+    {
+        this->frame = frame;
+        collect(false);
+    }
+
+    void begin(GpuPass pass) { timers[pass].begin(frame); }
+    void end(GpuPass pass) { timers[pass].end(); }
+
+    // with wait every outstanding result is read, only meant for after glFinish
+    // ------------------------------------------------------------------------
+    void collect(bool wait)
+    {
+        for (int i = 0; i < GPU_PASS_COUNT; i++)
+        {
+            unsigned int resultFrame;
+            double ms;
+            while (timers[i].read(resultFrame, ms, wait))
+            {
+                smoothed[i] = seen[i] ? smoothed[i] * 0.95 + ms * 0.05 : ms;
+                seen[i] = true;
+                lastFrame[i] = resultFrame;
+                if (resultFrame >= windowStart)
+                {
+                    sum[i] += ms;
+                    count[i]++;
+                }
+            }
+        }
+    }
+
+    // start a new measurement window at the given frame
+    void reset(unsigned int frame)
+    {
+        windowStart = frame;
+        for (int i = 0; i < GPU_PASS_COUNT; i++)
+        {
+            sum[i] = 0.0;
+            count[i] = 0;
+        }
+    }
+
+    // average time of a pass over the measurement window, 0 if it did not run
+    double average(GpuPass pass) const
+    {
+        return count[pass] ? sum[pass] / count[pass] : 0.0;
+    }
+
+    // smoothed time of a pass for display; false if the pass has not run lately
+    bool recent(GpuPass pass, double& ms) const
+    {
+        if (!seen[pass] || frame - lastFrame[pass] > 2 * GPU_TIMER_LATENCY)
+            return false;
+        ms = smoothed[pass];
+        return true;
+    }
+
+private:
+    GpuTimer timers[GPU_PASS_COUNT];
+    unsigned int frame;
+    unsigned int windowStart;
+    double smoothed[GPU_PASS_COUNT];
+    double sum[GPU_PASS_COUNT];
+    unsigned int count[GPU_PASS_COUNT];
+    unsigned int lastFrame[GPU_PASS_COUNT];
+    bool seen[GPU_PASS_COUNT];
+};
+
+#endif
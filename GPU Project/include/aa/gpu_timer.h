@@ -0,0 +1,103 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+// number of frames a query stays in flight before it is reused
+#define GPU_TIMER_LATENCY 3
+
+// Measures the GPU time of a span of commands with a pair of GL_TIMESTAMP queries.
+// Timestamps (unlike GL_TIME_ELAPSED) can overlap, so timers may be nested. Every frame
+// uses its own pair of queries out of a ring, and results are only read once the GPU
+// reports them available, so reading a result never stalls the pipeline.
+class GpuTimer
+{
+public:
+    GpuTimer()
+    {
+        for (unsigned int i = 0; i < GPU_TIMER_LATENCY; i++)
+        {
+            slots[i].queries[0] = slots[i].queries[1] = 0;
+            slots[i].frame = 0;
+            slots[i].pending = false;
+        }
+        current = 0;
+    }
+
+    // needs a current GL context
+    void init()
+    {
+        for (unsigned int i = 0; i < GPU_TIMER_LATENCY; i++)
+            glGenQueries(2, slots[i].queries);
+    }
+
+    void release()
+    {
+        for (unsigned int i = 0; i < GPU_TIMER_LATENCY; i++)
+        {
+            glDeleteQueries(2, slots[i].queries);
+            slots[i].pending = false;
+        }
+    }
+
+    // start timing the commands of the given frame
+    // ------------------------------------------------------------------------
+    void begin(unsigned int frame)
+    {
+        current = frame % GPU_TIMER_LATENCY;
+        // a result that was never read is dropped rather than waited for
+        slots[current].pending = false;
+        slots[current].frame = frame;
+        glQueryCounter(slots[current].queries[0], GL_TIMESTAMP);
+    }
+
+    void end()
+    {
+        glQueryCounter(slots[current].queries[1], GL_TIMESTAMP);
+        slots[current].pending = true;
+    }
+
+    // returns the oldest finished measurement, if there is one. With wait the result is
+    // read even if the GPU has not reached it yet, which is only meant for after glFinish.
+    // ------------------------------------------------------------------------
+    bool read(unsigned int& frame, double& ms, bool wait = false)
+    {
+        Slot* slot = NULL;
+        for (unsigned int i = 0; i < GPU_TIMER_LATENCY; i++)
+        {
+            if (slots[i].pending && (slot == NULL || slots[i].frame < slot->frame))
+                slot = &slots[i];
+        }
+        if (slot == NULL)
+            return false;
+
+        GLint available = 0;
+        glGetQueryObjectiv(slot->queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available && !wait)
+            return false;
+
+        GLuint64 begin, end;
+        glGetQueryObjectui64v(slot->queries[0], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(slot->queries[1], GL_QUERY_RESULT, &end);
+        slot->pending = false;
+
+        frame = slot->frame;
+        ms = (end - begin) / 1000000.0;
+        return true;
+    }
+
+private:
+    struct Slot
+    {
+        GLuint queries[2];
+        unsigned int frame;
+        bool pending;
+    };
+
+    Slot slots[GPU_TIMER_LATENCY];
+    unsigned int current;
+};
+
+#endif
@@ -0,0 +1,295 @@
+#ifndef GROUND_TRUTH_H
+#define GROUND_TRUTH_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <aa/image_io.h>
+#include <aa/thread_pool.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+// largest tile rendered at once, in samples; 16x16 at 1600x900 is 13 x 8 tiles
+#define GROUND_TRUTH_TILE_SIZE 2048
+// support of the reconstruction filter, in output pixels
+#define GROUND_TRUTH_FILTER_RADIUS 2.0f
+
+// Mitchell-Netravali filter with B = C = 1/3, sharper than a gaussian without the ringing of a
+// lanczos; x in output pixels
+// ------------------------------------------------------------------------
+inline float mitchellFilter(float x)
+{
+    const float B = 1.0f / 3.0f;
+    const float C = 1.0f / 3.0f;
+    x = std::fabs(x);
+    if (x < 1.0f)
+        return ((12.0f - 9.0f * B - 6.0f * C) * x * x * x + (-18.0f + 12.0f * B + 6.0f * C) * x * x + (6.0f - 2.0f * B)) / 6.0f;
+    if (x < 2.0f)
+        return ((-B - 6.0f * C) * x * x * x + (6.0f * B + 30.0f * C) * x * x + (-12.0f * B - 48.0f * C) * x + (8.0f * B + 24.0f * C)) / 6.0f;
+    return 0.0f;
+}
+
+// Downsamples a factor x factor supersampled image that arrives in tiles, so the full image is
+// never held. Every tile is filtered into a 32-bit float accumulator at the output resolution:
+// first along its rows, down to the output columns, then each filtered row is added to the output
+// rows it is in the support of. The filter is separable, so the weight of an output pixel is the
+// product of two per axis sums and is divided out once in resolve. Rows are in GL order.
+class ReferenceAccumulator
+{
+public:
+    explicit ReferenceAccumulator(ThreadPool* pool = &sharedThreadPool(), int bandHeight = 16)
+        : pool(pool), bandHeight(std::max(bandHeight, 1))
+    {
+        width = 0;
+        height = 0;
+        factor = 0;
+    }
+
+    void init(int width, int height, int factor)
+    {
+        this->width = width;
+        this->height = height;
+        this->factor = factor;
+        columns.build(width, factor);
+        rows.build(height, factor);
+        accum.assign((size_t)width * height * 3, 0.0f);
+    }
+
+    int sampleWidth() const { return width * factor; }
+    int sampleHeight() const { return height * factor; }
+
+    // adds the samples of tile, whose first sample is (x0, y0) of the supersampled image
+    // ------------------------------------------------------------------------
+    void addTile(const RGBAImage& tile, int x0, int y0)
+    {
+        int x1 = std::min(x0 + tile.width, sampleWidth());
+        int y1 = std::min(y0 + tile.height, sampleHeight());
+        int outX0, outX1, outY0, outY1;
+        if (!columns.touched(x0, x1, outX0, outX1) || !rows.touched(y0, y1, outY0, outY1))
+            return;
+
+        // bands of output rows, each only writes its own rows of the accumulator
+        parallelRows(pool, outY1 - outY0, bandHeight, [&](int band0, int band1) {
+            band0 += outY0;
+            band1 += outY0;
+            std::vector<float> filtered((size_t)(outX1 - outX0) * 3);
+            int sy0 = std::max(rows.first[band0], y0);
+            int sy1 = std::min(rows.first[band1 - 1] + rows.count[band1 - 1], y1);
+            for (int sy = sy0; sy < sy1; sy++)
+            {
+                // the sample row, filtered down to the output columns the tile reaches
+                const unsigned char* samples = tile.row(sy - y0);
+                for (int ox = outX0; ox < outX1; ox++)
+                {
+                    int s0 = std::max(columns.first[ox], x0);
+                    int s1 = std::min(columns.first[ox] + columns.count[ox], x1);
+                    const float* weights = columns.weights.data() + columns.offset[ox] + (s0 - columns.first[ox]);
+                    const unsigned char* sample = samples + (size_t)(s0 - x0) * 4;
+                    float r = 0.0f, g = 0.0f, b = 0.0f;
+                    for (int s = s0; s < s1; s++, sample += 4)
+                    {
+                        float w = *weights++;
+                        r += w * sample[0];
+                        g += w * sample[1];
+                        b += w * sample[2];
+                    }
+                    float* out = filtered.data() + (size_t)(ox - outX0) * 3;
+                    out[0] = r;
+                    out[1] = g;
+                    out[2] = b;
+                }
+
+                for (int oy = band0; oy < band1; oy++)
+                {
+                    if (sy < rows.first[oy] || sy >= rows.first[oy] + rows.count[oy])
+                        continue;
+                    float w = rows.weights[rows.offset[oy] + (sy - rows.first[oy])];
+                    float* out = accum.data() + ((size_t)oy * width + outX0) * 3;
+                    for (size_t i = 0; i < filtered.size(); i++)
+                        out[i] += w * filtered[i];
+                }
+            }
+        });
+    }
+
+    // the filtered image, once every tile was added; the negative lobes can overshoot
+    // ------------------------------------------------------------------------
+    void resolve(RGBAImage& target)
+    {
+        target.resize(width, height);
+        parallelRows(pool, height, bandHeight, [&](int y0, int y1) {
+            for (int y = y0; y < y1; y++)
+            {
+                const float* in = accum.data() + (size_t)y * width * 3;
+                unsigned char* out = target.row(y);
+                for (int x = 0; x < width; x++, in += 3, out += 4)
+                {
+                    float norm = 1.0f / (columns.sums[x] * rows.sums[y]);
+                    for (int c = 0; c < 3; c++)
+                        out[c] = (unsigned char)std::min(std::max(in[c] * norm + 0.5f, 0.0f), 255.0f);
+                    out[3] = 255;
+                }
+            }
+        });
+    }
+
+private:
+    // filter weights along one axis: output pixel o covers the samples first[o] .. first[o] +
+    // count[o] - 1, with their weights at offset[o]
+    struct Axis
+    {
+        std::vector<int> first;
+        std::vector<int> count;
+        std::vector<int> offset;
+        std::vector<float> weights;
+        std::vector<float> sums;
+
+        void build(int size, int factor)
+        {
+            int samples = size * factor;
+            float radius = GROUND_TRUTH_FILTER_RADIUS * factor;
+            first.resize(size);
+            count.resize(size);
+            offset.resize(size);
+            sums.resize(size);
+            weights.clear();
+            for (int o = 0; o < size; o++)
+            {
+                // sample s is centered at s + 0.5, output pixel o at (o + 0.5) * factor
+                float center = (o + 0.5f) * factor;
+                int s0 = std::max((int)std::ceil(center - radius - 0.5f), 0);
+                int s1 = std::min((int)std::floor(center + radius - 0.5f) + 1, samples);
+                first[o] = s0;
+                count[o] = std::max(s1 - s0, 0);
+                offset[o] = (int)weights.size();
+                sums[o] = 0.0f;
+                for (int s = s0; s < s1; s++)
+                {
+                    float w = mitchellFilter((s + 0.5f - center) / factor);
+                    weights.push_back(w);
+                    sums[o] += w;
+                }
+            }
+        }
+
+        // the output pixels with samples in s0 .. s1 - 1
+        bool touched(int s0, int s1, int& o0, int& o1) const
+        {
+            int size = (int)first.size();
+            o0 = 0;
+            while (o0 < size && first[o0] + count[o0] <= s0)
+                o0++;
+            o1 = o0;
+            while (o1 < size && first[o1] < s1)
+                o1++;
+            return o0 < o1;
+        }
+    };
+
+    ThreadPool* pool;
+    int bandHeight;
+    int width;
+    int height;
+    int factor;
+    Axis columns;
+    Axis rows;
+    std::vector<float> accum;       // RGB, weighted sums in 8-bit levels
+};
+
+// Renders the ground truth of a view: width x height at factor x factor samples per pixel, in tiles
+// that fit a framebuffer. draw(tile) renders the scene into the bound framebuffer with tile *
+// projection in place of its projection, which zooms the clip space in on the tile; it also clears.
+// The GPU draws the next tile while the workers filter the last one. The viewport and framebuffer
+// binding are restored afterwards; needs a current GL context.
+// ------------------------------------------------------------------------
+inline bool renderGroundTruth(int width, int height, int factor, const std::function<void(const glm::mat4& tile)>& draw,
+    RGBAImage& target, ThreadPool* pool = &sharedThreadPool())
+{
+    GLint maxRenderbuffer = 0, maxViewport[2] = { 0, 0 }, viewport[4];
+    glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &maxRenderbuffer);
+    glGetIntegerv(GL_MAX_VIEWPORT_DIMS, maxViewport);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    int tileSize = std::min(std::min(GROUND_TRUTH_TILE_SIZE, (int)maxRenderbuffer), (int)std::min(maxViewport[0], maxViewport[1]));
+
+    ReferenceAccumulator accumulator(pool);
+    accumulator.init(width, height, factor);
+    int samplesX = accumulator.sampleWidth();
+    int samplesY = accumulator.sampleHeight();
+    if (samplesX == 0 || samplesY == 0 || tileSize <= 0)
+    {
+        std::cout << "ERROR::GROUND_TRUTH::INVALID_SIZE" << std::endl;
+        return false;
+    }
+
+    GLuint fbo;
+    GLuint renderbuffers[2];
+    glGenFramebuffers(1, &fbo);
+    glGenRenderbuffers(2, renderbuffers);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, tileSize, tileSize);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, tileSize, tileSize);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    if (!complete)
+        std::cout << "ERROR::GROUND_TRUTH::FRAMEBUFFER_NOT_COMPLETE" << std::endl;
+
+    // the tile read last is filtered while the GPU draws the next one
+    RGBAImage tiles[2];
+    int pendingX = 0, pendingY = 0;
+    bool pending = false;
+    int current = 0;
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    for (int y0 = 0; complete && y0 < samplesY; y0 += tileSize)
+    {
+        for (int x0 = 0; x0 < samplesX; x0 += tileSize)
+        {
+            int w = std::min(tileSize, samplesX - x0);
+            int h = std::min(tileSize, samplesY - y0);
+
+            // maps the tile's part of clip space onto all of it
+            float left = 2.0f * x0 / samplesX - 1.0f;
+            float bottom = 2.0f * y0 / samplesY - 1.0f;
+            float sizeX = 2.0f * w / samplesX;
+            float sizeY = 2.0f * h / samplesY;
+            glm::mat4 tile = glm::scale(glm::mat4(1.0f), glm::vec3(2.0f / sizeX, 2.0f / sizeY, 1.0f));
+            tile = glm::translate(tile, glm::vec3(-(left + 0.5f * sizeX), -(bottom + 0.5f * sizeY), 0.0f));
+
+            glViewport(0, 0, w, h);
+            draw(tile);
+            glFlush();
+
+            if (pending)
+                accumulator.addTile(tiles[1 - current], pendingX, pendingY);
+
+            RGBAImage& image = tiles[current];
+            if (image.width != w || image.height != h)
+                image.resize(w, h);
+            glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels.data());
+            pendingX = x0;
+            pendingY = y0;
+            pending = true;
+            current = 1 - current;
+        }
+    }
+    if (pending)
+        accumulator.addTile(tiles[1 - current], pendingX, pendingY);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteRenderbuffers(2, renderbuffers);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+    if (complete)
+        accumulator.resolve(target);
+    return complete;
+}
+
+#endif
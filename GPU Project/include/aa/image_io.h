@@ -0,0 +1,211 @@
+#ifndef IMAGE_IO_H
+#define IMAGE_IO_H
+
+// model.h includes the stb_image implementation, which must not be pulled in a second time
+#ifndef STBI_INCLUDE_STB_IMAGE_H
+#include <stb_image.h>
+#endif
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// 8-bit RGBA pixels, rows in the order of the file, which is also the order glTexImage2D
+// uploads and glReadPixels returns them in (so row 0 is at texcoord y = 0)
+struct RGBAImage
+{
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> pixels;
+
+    void resize(int w, int h)
+    {
+        width = w;
+        height = h;
+        pixels.assign((size_t)w * h * 4, 0);
+    }
+
+    unsigned char* row(int y) { return pixels.data() + (size_t)y * width * 4; }
+    const unsigned char* row(int y) const { return pixels.data() + (size_t)y * width * 4; }
+};
+
+// any format stb_image reads, expanded to RGBA. bottomUp reverses the rows, for files written
+// from a framebuffer with writePNG(..., true).
+// ------------------------------------------------------------------------
+inline bool loadRGBAImage(const std::string& path, RGBAImage& image, bool bottomUp = false)
+{
+    int width, height, components;
+    unsigned char* data = stbi_load(path.c_str(), &width, &height, &components, 4);
+    if (data == NULL)
+    {
+        std::cout << "ERROR::IMAGE::FILE_NOT_SUCCESFULLY_READ: " << path << std::endl;
+        return false;
+    }
+
+    image.width = width;
+    image.height = height;
+    image.pixels.assign(data, data + (size_t)width * height * 4);
+    stbi_image_free(data);
+    if (bottomUp)
+    {
+        for (int y = 0; y < height / 2; y++)
+            std::swap_ranges(image.row(y), image.row(y) + (size_t)width * 4, image.row(height - 1 - y));
+    }
+    return true;
+}
+
+// per channel differences of the color of two images of the same size, alpha is ignored
+struct ImageDifference
+{
+    int maxDifference = 0;
+    int maxX = 0;               // first pixel with the largest difference
+    int maxY = 0;
+    double meanDifference = 0.0;
+    size_t pixelsOver = 0;      // pixels with a channel off by more than the tolerance
+};
+
+// ------------------------------------------------------------------------
+inline ImageDifference compareImages(const RGBAImage& a, const RGBAImage& b, int tolerance)
+{
+    ImageDifference difference;
+    if (a.width != b.width || a.height != b.height || a.pixels.empty())
+        return difference;
+
+    uint64_t sum = 0;
+    for (int y = 0; y < a.height; y++)
+    {
+        const unsigned char* rowA = a.row(y);
+        const unsigned char* rowB = b.row(y);
+        for (int x = 0; x < a.width; x++)
+        {
+            int pixelMax = 0;
+            for (int c = 0; c < 3; c++)
+            {
+                int d = std::abs(rowA[x * 4 + c] - rowB[x * 4 + c]);
+                sum += d;
+                pixelMax = std::max(pixelMax, d);
+            }
+            if (pixelMax > tolerance)
+                difference.pixelsOver++;
+            if (pixelMax > difference.maxDifference)
+            {
+                difference.maxDifference = pixelMax;
+                difference.maxX = x;
+                difference.maxY = y;
+            }
+        }
+    }
+    difference.meanDifference = (double)sum / ((double)a.width * a.height * 3);
+    return difference;
+}
+
+struct PNGCrcTable
+{
+    uint32_t entries[256];
+
+    PNGCrcTable()
+    {
+        for (uint32_t n = 0; n < 256; n++)
+        {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            entries[n] = c;
+        }
+    }
+};
+
+inline uint32_t pngCrc(const unsigned char* data, size_t size)
+{
+    static const PNGCrcTable table; // built once, also when several threads write images
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; i++)
+        crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+// RGBA PNG without a zlib dependency: the image data goes into stored (uncompressed) deflate
+// blocks, so the files are about as large as the raw pixels. bottomUp writes the last row
+// first, for images read back from a framebuffer.
+// ------------------------------------------------------------------------
+inline bool writePNG(const std::string& path, const RGBAImage& image, bool bottomUp = false)
+{
+    auto put32 = [](std::vector<unsigned char>& out, uint32_t v) {
+        out.push_back((unsigned char)(v >> 24));
+        out.push_back((unsigned char)(v >> 16));
+        out.push_back((unsigned char)(v >> 8));
+        out.push_back((unsigned char)v);
+    };
+    auto chunk = [&](std::vector<unsigned char>& out, const char* type, const std::vector<unsigned char>& data) {
+        put32(out, (uint32_t)data.size());
+        size_t start = out.size();
+        out.insert(out.end(), type, type + 4);
+        out.insert(out.end(), data.begin(), data.end());
+        put32(out, pngCrc(out.data() + start, out.size() - start));
+    };
+
+    // every row starts with filter type 0
+    size_t rowBytes = (size_t)image.width * 4;
+    std::vector<unsigned char> raw;
+    raw.reserve((rowBytes + 1) * image.height);
+    for (int y = 0; y < image.height; y++)
+    {
+        raw.push_back(0);
+        const unsigned char* row = image.row(bottomUp ? image.height - 1 - y : y);
+        raw.insert(raw.end(), row, row + rowBytes);
+    }
+
+    std::vector<unsigned char> zlib = { 0x78, 0x01 };
+    uint32_t adlerA = 1, adlerB = 0;
+    size_t offset = 0;
+    bool last = false;
+    while (!last)
+    {
+        size_t size = std::min<size_t>(raw.size() - offset, 65535);
+        last = offset + size == raw.size();
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back((unsigned char)size);
+        zlib.push_back((unsigned char)(size >> 8));
+        zlib.push_back((unsigned char)~size);
+        zlib.push_back((unsigned char)(~size >> 8));
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + size);
+        for (size_t i = offset; i < offset + size; i++)
+        {
+            adlerA = (adlerA + raw[i]) % 65521;
+            adlerB = (adlerB + adlerA) % 65521;
+        }
+        offset += size;
+    }
+    put32(zlib, (adlerB << 16) | adlerA);
+
+    std::vector<unsigned char> header;
+    put32(header, (uint32_t)image.width);
+    put32(header, (uint32_t)image.height);
+    header.push_back(8);    // bit depth
+    header.push_back(6);    // RGBA
+    header.push_back(0);
+    header.push_back(0);
+    header.push_back(0);
+
+    const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    std::vector<unsigned char> png(signature, signature + 8);
+    chunk(png, "IHDR", header);
+    chunk(png, "IDAT", zlib);
+    chunk(png, "IEND", std::vector<unsigned char>());
+
+    std::ofstream file(path, std::ios::binary);
+    file.write((const char*)png.data(), png.size());
+    if (!file)
+    {
+        std::cout << "ERROR::IMAGE::FILE_NOT_SUCCESFULLY_WRITTEN: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+#endif
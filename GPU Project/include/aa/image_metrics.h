@@ -0,0 +1,324 @@
+#ifndef IMAGE_METRICS_H
+#define IMAGE_METRICS_H
+
+#include <aa/fxaa_cpu.h>
+#include <aa/image_io.h>
+#include <aa/thread_pool.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Quality of a frame against a reference of the same view, e.g. the supersampled ground truth of
+// ground_truth.h:
+//   PSNR        of the RGB channels, in dB (infinite for identical images)
+//   SSIM        mean structural similarity of the luma, 11x11 gaussian window with sigma 1.5
+//   edge error  mean absolute luma error in 8-bit levels, weighted by the Sobel gradient of the
+//               reference, so it only looks at the edges AA is supposed to fix
+// The float kernels are written once against the FXAA lane types and run 1, 4 or 8 pixels at once
+// on bands of rows spread over the thread pool.
+struct ImageQuality
+{
+    double psnr = 0.0;
+    double ssim = 0.0;
+    double edgeError = 0.0;
+};
+
+#define IMAGE_METRICS_RADIUS 5          // of the SSIM window
+#define IMAGE_METRICS_TAPS (2 * IMAGE_METRICS_RADIUS + 1)
+
+class ImageMetrics
+{
+public:
+    explicit ImageMetrics(ThreadPool* pool = &sharedThreadPool(), int path = fxaaCpuBestPath(), int bandHeight = 32)
+        : pool(pool), path(path), bandHeight(std::max(bandHeight, 1))
+    {
+        width = 0;
+        height = 0;
+        stride = 0;
+
+        float sum = 0.0f;
+        for (int i = 0; i < IMAGE_METRICS_TAPS; i++)
+        {
+            float d = (float)(i - IMAGE_METRICS_RADIUS);
+            gaussian[i] = std::exp(-d * d / (2.0f * 1.5f * 1.5f));
+            sum += gaussian[i];
+        }
+        for (int i = 0; i < IMAGE_METRICS_TAPS; i++)
+            gaussian[i] /= sum;
+    }
+
+    // both images have to be of the same size; the buffers are kept for the next call
+    // ------------------------------------------------------------------------
+    ImageQuality compare(const RGBAImage& frame, const RGBAImage& reference)
+    {
+        ImageQuality quality;
+        if (frame.width != reference.width || frame.height != reference.height || frame.pixels.empty())
+        {
+            std::cout << "ERROR::METRICS::SIZE_MISMATCH " << frame.width << "x" << frame.height
+                << " vs " << reference.width << "x" << reference.height << std::endl;
+            return quality;
+        }
+
+        this->frame = &frame;
+        this->reference = &reference;
+        width = frame.width;
+        height = frame.height;
+        stride = width + 2 * IMAGE_METRICS_RADIUS;
+        lumaFrame.resize((size_t)stride * height);
+        lumaReference.resize((size_t)stride * height);
+        for (std::vector<float>& moment : moments)
+            moment.resize((size_t)width * height);
+        error.resize((size_t)width * height);
+        bands.assign((height + bandHeight - 1) / bandHeight, BandSums());
+
+        parallelRows(pool, height, bandHeight, [this](int y0, int y1) { horizontalPass(y0, y1); });
+        parallelRows(pool, height, bandHeight, [this](int y0, int y1) {
+            switch (path)
+            {
+#ifdef FXAA_CPU_HAS_AVX2
+            case FXAA_CPU_AVX2:
+                verticalPass<FxaaF8>(y0, y1);
+                break;
+#endif
+#ifdef FXAA_CPU_HAS_SSE4
+            case FXAA_CPU_SSE4:
+                verticalPass<FxaaF4>(y0, y1);
+                break;
+#endif
+            default:
+                verticalPass<FxaaF1>(y0, y1);
+                break;
+            }
+        });
+
+        BandSums total;
+        for (const BandSums& band : bands)
+        {
+            total.squaredError += band.squaredError;
+            total.ssim += band.ssim;
+            total.weightedError += band.weightedError;
+            total.weight += band.weight;
+        }
+        double pixels = (double)width * height;
+        double mse = (double)total.squaredError / (pixels * 3.0);
+        quality.psnr = mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : std::numeric_limits<double>::infinity();
+        quality.ssim = total.ssim / pixels;
+        quality.edgeError = total.weight > 0.0 ? 255.0 * total.weightedError / total.weight : 0.0;
+        return quality;
+    }
+
+    // the edge-weighted luma error of every pixel of the last compare
+    const std::vector<float>& errorMap() const { return error; }
+
+    // the error map as a gray image, white at the largest error
+    void errorImage(RGBAImage& image) const
+    {
+        image.resize(width, height);
+        float largest = 0.0f;
+        for (float e : error)
+            largest = std::max(largest, e);
+        float scale = largest > 0.0f ? 255.0f / largest : 0.0f;
+        for (size_t i = 0; i < error.size(); i++)
+        {
+            unsigned char v = (unsigned char)(error[i] * scale + 0.5f);
+            image.pixels[i * 4] = v;
+            image.pixels[i * 4 + 1] = v;
+            image.pixels[i * 4 + 2] = v;
+            image.pixels[i * 4 + 3] = 255;
+        }
+    }
+
+private:
+    struct BandSums
+    {
+        uint64_t squaredError = 0;
+        double ssim = 0.0;
+        double weightedError = 0.0;
+        double weight = 0.0;
+    };
+
+    ThreadPool* pool;
+    int path;
+    int bandHeight;
+    int width;
+    int height;
+    int stride;                         // of the luma planes, a border of RADIUS replicated pixels
+    float gaussian[IMAGE_METRICS_TAPS];
+    const RGBAImage* frame = NULL;
+    const RGBAImage* reference = NULL;
+    std::vector<float> lumaFrame;
+    std::vector<float> lumaReference;
+    std::vector<float> moments[5];      // x, y, x^2, y^2 and xy blurred along the rows
+    std::vector<float> error;
+    std::vector<BandSums> bands;
+
+    static float luma(const unsigned char* pixel)
+    {
+        return (pixel[0] * 0.2126f + pixel[1] * 0.7152f + pixel[2] * 0.0722f) / 255.0f;
+    }
+
+    // luma of both images, the squared RGB error, and the row half of the SSIM blur
+    // ------------------------------------------------------------------------
+    void horizontalPass(int y0, int y1)
+    {
+        uint64_t squaredError = 0;
+        for (int y = y0; y < y1; y++)
+        {
+            const unsigned char* rowA = frame->row(y);
+            const unsigned char* rowB = reference->row(y);
+            float* a = lumaFrame.data() + (size_t)y * stride + IMAGE_METRICS_RADIUS;
+            float* b = lumaReference.data() + (size_t)y * stride + IMAGE_METRICS_RADIUS;
+            for (int x = 0; x < width; x++)
+            {
+                for (int c = 0; c < 3; c++)
+                {
+                    int d = rowA[x * 4 + c] - rowB[x * 4 + c];
+                    squaredError += d * d;
+                }
+                a[x] = luma(rowA + x * 4);
+                b[x] = luma(rowB + x * 4);
+            }
+            for (int i = 1; i <= IMAGE_METRICS_RADIUS; i++)
+            {
+                a[-i] = a[0];
+                b[-i] = b[0];
+                a[width - 1 + i] = a[width - 1];
+                b[width - 1 + i] = b[width - 1];
+            }
+
+            switch (path)
+            {
+#ifdef FXAA_CPU_HAS_AVX2
+            case FXAA_CPU_AVX2:
+                blurRow<FxaaF8>(y);
+                break;
+#endif
+#ifdef FXAA_CPU_HAS_SSE4
+            case FXAA_CPU_SSE4:
+                blurRow<FxaaF4>(y);
+                break;
+#endif
+            default:
+                blurRow<FxaaF1>(y);
+                break;
+            }
+        }
+        bands[y0 / bandHeight].squaredError = squaredError;
+    }
+
+    template <class F>
+    void blurRow(int y)
+    {
+        int x = 0;
+        for (; x + F::lanes <= width; x += F::lanes)
+            blurPixels<F>(x, y);
+        for (; x < width; x++)
+            blurPixels<FxaaF1>(x, y);
+    }
+
+    template <class F>
+    void blurPixels(int x, int y)
+    {
+        const float* a = lumaFrame.data() + (size_t)y * stride + x;
+        const float* b = lumaReference.data() + (size_t)y * stride + x;
+        F sumA = 0.0f, sumB = 0.0f, sumAA = 0.0f, sumBB = 0.0f, sumAB = 0.0f;
+        for (int i = 0; i < IMAGE_METRICS_TAPS; i++)
+        {
+            F w = gaussian[i];
+            F va = F::load(a + i);
+            F vb = F::load(b + i);
+            F wa = w * va;
+            F wb = w * vb;
+            sumA = sumA + wa;
+            sumB = sumB + wb;
+            sumAA = sumAA + wa * va;
+            sumBB = sumBB + wb * vb;
+            sumAB = sumAB + wa * vb;
+        }
+        size_t i = (size_t)y * width + x;
+        sumA.store(moments[0].data() + i);
+        sumB.store(moments[1].data() + i);
+        sumAA.store(moments[2].data() + i);
+        sumBB.store(moments[3].data() + i);
+        sumAB.store(moments[4].data() + i);
+    }
+
+    // the column half of the blur, SSIM, and the edge-weighted error
+    // ------------------------------------------------------------------------
+    template <class F>
+    void verticalPass(int y0, int y1)
+    {
+        BandSums& band = bands[y0 / bandHeight];
+        for (int y = y0; y < y1; y++)
+        {
+            float sums[3] = { 0.0f, 0.0f, 0.0f };
+            int x = 0;
+            for (; x + F::lanes <= width; x += F::lanes)
+                qualityPixels<F>(x, y, sums);
+            for (; x < width; x++)
+                qualityPixels<FxaaF1>(x, y, sums);
+            band.ssim += sums[0];
+            band.weightedError += sums[1];
+            band.weight += sums[2];
+        }
+    }
+
+    template <class F>
+    static float laneSum(F v)
+    {
+        float lanes[F::lanes];
+        v.store(lanes);
+        float sum = 0.0f;
+        for (int i = 0; i < F::lanes; i++)
+            sum += lanes[i];
+        return sum;
+    }
+
+    template <class F>
+    void qualityPixels(int x, int y, float* sums)
+    {
+        F mA = 0.0f, mB = 0.0f, mAA = 0.0f, mBB = 0.0f, mAB = 0.0f;
+        for (int i = 0; i < IMAGE_METRICS_TAPS; i++)
+        {
+            int row = std::min(std::max(y + i - IMAGE_METRICS_RADIUS, 0), height - 1);
+            size_t index = (size_t)row * width + x;
+            F w = gaussian[i];
+            mA = mA + w * F::load(moments[0].data() + index);
+            mB = mB + w * F::load(moments[1].data() + index);
+            mAA = mAA + w * F::load(moments[2].data() + index);
+            mBB = mBB + w * F::load(moments[3].data() + index);
+            mAB = mAB + w * F::load(moments[4].data() + index);
+        }
+
+        // the constants of the paper for a dynamic range of 1
+        const F c1 = 0.01f * 0.01f;
+        const F c2 = 0.03f * 0.03f;
+        F varianceA = mAA - mA * mA;
+        F varianceB = mBB - mB * mB;
+        F covariance = mAB - mA * mB;
+        F ssim = ((F(2.0f) * mA * mB + c1) * (F(2.0f) * covariance + c2))
+            / ((mA * mA + mB * mB + c1) * (varianceA + varianceB + c2));
+
+        // Sobel of the reference, |gx| + |gy| scaled to 0..1
+        const float* a = lumaFrame.data() + (size_t)y * stride + IMAGE_METRICS_RADIUS + x;
+        const float* up = lumaReference.data() + (size_t)std::max(y - 1, 0) * stride + IMAGE_METRICS_RADIUS + x;
+        const float* center = lumaReference.data() + (size_t)y * stride + IMAGE_METRICS_RADIUS + x;
+        const float* down = lumaReference.data() + (size_t)std::min(y + 1, height - 1) * stride + IMAGE_METRICS_RADIUS + x;
+        F gx = (F::load(up + 1) + F(2.0f) * F::load(center + 1) + F::load(down + 1))
+            - (F::load(up - 1) + F(2.0f) * F::load(center - 1) + F::load(down - 1));
+        F gy = (F::load(down - 1) + F(2.0f) * F::load(down) + F::load(down + 1))
+            - (F::load(up - 1) + F(2.0f) * F::load(up) + F::load(up + 1));
+        F weight = (fxaaAbs(gx) + fxaaAbs(gy)) * F(0.125f);
+        F weighted = weight * fxaaAbs(F::load(a) - F::load(center));
+        weighted.store(error.data() + (size_t)y * width + x);
+
+        sums[0] += laneSum(ssim);
+        sums[1] += laneSum(weighted);
+        sums[2] += laneSum(weight);
+    }
+};
+
+#endif
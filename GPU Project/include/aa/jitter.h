@@ -0,0 +1,75 @@
+#ifndef JITTER_H
+#define JITTER_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+
+// Sub-pixel jitter sequences of TAA, numbered the same way as the Jitter combo in the
+// Control Panel. Halton and R2 are low-discrepancy sequences: any run of consecutive
+// samples covers the pixel evenly, so the history converges over one cycle.
+enum JitterSequence {
+    JITTER_T2X = 0,     // the two positions of SMAA T2x
+    JITTER_HALTON = 1,  // Halton (2, 3)
+    JITTER_R2 = 2,      // R2, the plastic number generalization of the golden ratio sequence
+    JITTER_SMAA_4X = 3  // the two camera jitters of SMAA 4x, set by the SMAA mode only
+};
+
+const char* const jitterSequenceNames[] = { "T2X", "HALTON", "R2", "SMAA4X" };
+
+#define JITTER_MIN_SAMPLES 2
+#define JITTER_MAX_SAMPLES 16
+
+// number of positions before the sequence starts over; the SMAA patterns always have two
+inline int jitterSampleCount(int sequence, int samples)
+{
+    if (sequence == JITTER_T2X || sequence == JITTER_SMAA_4X)
+        return 2;
+    return std::min(std::max(samples, JITTER_MIN_SAMPLES), JITTER_MAX_SAMPLES);
+}
+
+// the digits of index in the given base, mirrored around the decimal point
+inline float radicalInverse(unsigned int index, unsigned int base)
+{
+    float result = 0.0f;
+    float digitWeight = 1.0f / base;
+    while (index > 0)
+    {
+        result += (index % base) * digitWeight;
+        index /= base;
+        digitWeight /= base;
+    }
+    return result;
+}
+
+// offset of the given frame in pixels, within (-0.5, 0.5)
+// ------------------------------------------------------------------------
+inline glm::vec2 jitterOffset(int sequence, int samples, unsigned int frame)
+{
+    unsigned int index = frame % jitterSampleCount(sequence, samples);
+    switch (sequence)
+    {
+    case JITTER_HALTON:
+        // index 0 is (0, 0) in every base, start at 1 like the usual TAA implementations
+        return glm::vec2(radicalInverse(index + 1, 2), radicalInverse(index + 1, 3)) - 0.5f;
+    case JITTER_R2:
+    {
+        const double g = 1.32471795724474602596; // plastic number, x^3 = x + 1
+        double x = 0.5 + (index + 1) / g;
+        double y = 0.5 + (index + 1) / (g * g);
+        return glm::vec2((float)(x - (long long)x), (float)(y - (long long)y)) - 0.5f;
+    }
+    case JITTER_SMAA_4X:
+        return index == 0 ? glm::vec2(0.125f, 0.125f) : glm::vec2(-0.125f, -0.125f);
+    default:
+    {
+        const glm::vec2 t2x[2] = {
+            { -0.25f,  0.25f }
+            ,{ 0.25f,  -0.25f }
+        };
+        return t2x[index];
+    }
+    }
+}
+
+#endif
@@ -0,0 +1,215 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <learnopengl/mesh.h>
+#include <aa/mapped_file.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Binary cache of the meshes Assimp imported from a model file, stored next to it as
+// <model>.meshcache. It is only used if it was written by the same version, with the same
+// import flags and vertex layout, from a source file with the same hash; otherwise the
+// model is imported again and the cache rewritten. Layout (every section 16-byte aligned):
+//   MeshCacheHeader | MeshCacheMesh[] | MeshCacheTexture[] | uint32 texture refs[] |
+//   strings | Vertex[] | uint32 indices[]
+#define MESH_CACHE_VERSION 1
+
+struct MeshCacheHeader
+{
+    char magic[4];              // "AAMC"
+    uint32_t version;
+    uint32_t vertexSize;        // sizeof(Vertex)
+    uint32_t importFlags;
+    uint64_t sourceHash;
+    uint64_t fileSize;
+    uint32_t meshCount;
+    uint32_t textureCount;
+    uint32_t textureRefCount;
+    uint32_t stringSize;
+    uint64_t vertexCount;
+    uint64_t indexCount;
+    uint64_t meshOffset;
+    uint64_t textureOffset;
+    uint64_t textureRefOffset;
+    uint64_t stringOffset;
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+};
+
+struct MeshCacheMesh
+{
+    uint64_t firstVertex;
+    uint64_t firstIndex;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t firstTextureRef;   // the textures of a mesh are a range of the texture refs,
+    uint32_t textureRefCount;   // each an index into the texture table
+};
+
+struct MeshCacheTexture
+{
+    uint32_t typeOffset;        // into the string section
+    uint32_t typeLength;
+    uint32_t pathOffset;
+    uint32_t pathLength;
+};
+
+inline uint64_t meshCacheAlign(uint64_t offset)
+{
+    return (offset + 15) & ~(uint64_t)15;
+}
+
+// writes the meshes of a freshly imported model; textures are the model's textures_loaded
+// ------------------------------------------------------------------------
+inline bool writeMeshCache(const std::string& path, uint64_t sourceHash, uint32_t importFlags,
+    const std::vector<Mesh>& meshes, const std::vector<Texture>& textures)
+{
+    MeshCacheHeader header = {};
+    std::memcpy(header.magic, "AAMC", 4);
+    header.version = MESH_CACHE_VERSION;
+    header.vertexSize = sizeof(Vertex);
+    header.importFlags = importFlags;
+    header.sourceHash = sourceHash;
+    header.meshCount = (uint32_t)meshes.size();
+    header.textureCount = (uint32_t)textures.size();
+
+    std::vector<MeshCacheMesh> cacheMeshes;
+    std::vector<uint32_t> textureRefs;
+    for (const Mesh& mesh : meshes)
+    {
+        MeshCacheMesh cacheMesh;
+        cacheMesh.firstVertex = header.vertexCount;
+        cacheMesh.firstIndex = header.indexCount;
+        cacheMesh.vertexCount = (uint32_t)mesh.vertices.size();
+        cacheMesh.indexCount = (uint32_t)mesh.indices.size();
+        cacheMesh.firstTextureRef = (uint32_t)textureRefs.size();
+        cacheMesh.textureRefCount = (uint32_t)mesh.textures.size();
+        for (const Texture& texture : mesh.textures)
+        {
+            uint32_t ref = 0;
+            while (ref < textures.size() && textures[ref].id != texture.id)
+                ref++;
+            if (ref == textures.size())
+                return false; // not one of the model's textures, nothing to refer to
+            textureRefs.push_back(ref);
+        }
+        header.vertexCount += mesh.vertices.size();
+        header.indexCount += mesh.indices.size();
+        cacheMeshes.push_back(cacheMesh);
+    }
+    header.textureRefCount = (uint32_t)textureRefs.size();
+
+    std::string strings;
+    std::vector<MeshCacheTexture> cacheTextures;
+    for (const Texture& texture : textures)
+    {
+        MeshCacheTexture cacheTexture;
+        cacheTexture.typeOffset = (uint32_t)strings.size();
+        cacheTexture.typeLength = (uint32_t)texture.type.size();
+        strings += texture.type;
+        cacheTexture.pathOffset = (uint32_t)strings.size();
+        cacheTexture.pathLength = (uint32_t)texture.path.size();
+        strings += texture.path;
+        cacheTextures.push_back(cacheTexture);
+    }
+    header.stringSize = (uint32_t)strings.size();
+
+    header.meshOffset = meshCacheAlign(sizeof(MeshCacheHeader));
+    header.textureOffset = meshCacheAlign(header.meshOffset + cacheMeshes.size() * sizeof(MeshCacheMesh));
+    header.textureRefOffset = meshCacheAlign(header.textureOffset + cacheTextures.size() * sizeof(MeshCacheTexture));
+    header.stringOffset = meshCacheAlign(header.textureRefOffset + textureRefs.size() * sizeof(uint32_t));
+    header.vertexOffset = meshCacheAlign(header.stringOffset + strings.size());
+    header.indexOffset = meshCacheAlign(header.vertexOffset + header.vertexCount * sizeof(Vertex));
+    header.fileSize = header.indexOffset + header.indexCount * sizeof(unsigned int);
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        std::cout << "ERROR::MESH_CACHE::FILE_NOT_SUCCESFULLY_WRITTEN: " << path << std::endl;
+        return false;
+    }
+
+    auto seek = [&](uint64_t offset) {
+        static const char zeros[16] = {};
+        file.write(zeros, (std::streamsize)(offset - (uint64_t)file.tellp()));
+    };
+
+    file.write((const char*)&header, sizeof(header));
+    seek(header.meshOffset);
+    file.write((const char*)cacheMeshes.data(), cacheMeshes.size() * sizeof(MeshCacheMesh));
+    seek(header.textureOffset);
+    file.write((const char*)cacheTextures.data(), cacheTextures.size() * sizeof(MeshCacheTexture));
+    seek(header.textureRefOffset);
+    file.write((const char*)textureRefs.data(), textureRefs.size() * sizeof(uint32_t));
+    seek(header.stringOffset);
+    file.write(strings.data(), strings.size());
+    seek(header.vertexOffset);
+    for (const Mesh& mesh : meshes)
+        file.write((const char*)mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+    seek(header.indexOffset);
+    for (const Mesh& mesh : meshes)
+        file.write((const char*)mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int));
+
+    if (!file)
+    {
+        std::cout << "ERROR::MESH_CACHE::FILE_NOT_SUCCESFULLY_WRITTEN: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// checks that a mapped cache file is complete and matches the source; returns its header or NULL
+// ------------------------------------------------------------------------
+inline const MeshCacheHeader* validateMeshCache(const MappedFile& file, uint64_t sourceHash, uint32_t importFlags)
+{
+    if (file.length() < sizeof(MeshCacheHeader))
+        return NULL;
+
+    const MeshCacheHeader* header = (const MeshCacheHeader*)file.bytes();
+    if (std::memcmp(header->magic, "AAMC", 4) != 0
+        || header->version != MESH_CACHE_VERSION
+        || header->vertexSize != sizeof(Vertex)
+        || header->importFlags != importFlags
+        || header->sourceHash != sourceHash
+        || header->fileSize != file.length())
+        return NULL;
+
+    // every section has to lie inside the file (a torn write shows up here)
+    if (header->meshOffset + (uint64_t)header->meshCount * sizeof(MeshCacheMesh) > header->textureOffset
+        || header->textureOffset + (uint64_t)header->textureCount * sizeof(MeshCacheTexture) > header->textureRefOffset
+        || header->textureRefOffset + (uint64_t)header->textureRefCount * sizeof(uint32_t) > header->stringOffset
+        || header->stringOffset + header->stringSize > header->vertexOffset
+        || header->vertexOffset + header->vertexCount * sizeof(Vertex) > header->indexOffset
+        || header->indexOffset + header->indexCount * sizeof(unsigned int) > header->fileSize)
+        return NULL;
+
+    const MeshCacheMesh* meshes = (const MeshCacheMesh*)(file.bytes() + header->meshOffset);
+    for (uint32_t i = 0; i < header->meshCount; i++)
+    {
+        if (meshes[i].firstVertex + meshes[i].vertexCount > header->vertexCount
+            || meshes[i].firstIndex + meshes[i].indexCount > header->indexCount
+            || (uint64_t)meshes[i].firstTextureRef + meshes[i].textureRefCount > header->textureRefCount)
+            return NULL;
+    }
+    const MeshCacheTexture* textures = (const MeshCacheTexture*)(file.bytes() + header->textureOffset);
+    for (uint32_t i = 0; i < header->textureCount; i++)
+    {
+        if ((uint64_t)textures[i].typeOffset + textures[i].typeLength > header->stringSize
+            || (uint64_t)textures[i].pathOffset + textures[i].pathLength > header->stringSize)
+            return NULL;
+    }
+    const uint32_t* textureRefs = (const uint32_t*)(file.bytes() + header->textureRefOffset);
+    for (uint32_t i = 0; i < header->textureRefCount; i++)
+    {
+        if (textureRefs[i] >= header->textureCount)
+            return NULL;
+    }
+    return header;
+}
+
+#endif
@@ -0,0 +1,172 @@
+#ifndef MSAA_TARGETS_H
+#define MSAA_TARGETS_H
+
+#include <aa/gl_ext.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+// a multisampled color + velocity + depth/stencil set with immutable storage
+struct MultisampleTarget
+{
+    GLuint colorTex;
+    GLuint velocityTex;     // RG16F motion vectors, the second color attachment; 0 until TAA needs it
+    GLuint depthTex;
+    GLsizei samples;
+    GLsizei width;
+    GLsizei height;
+    GLenum format;
+};
+
+// Keeps one set of multisampled render targets per (sample count, size, format), so
+// switching the MSAA quality only swaps the FBO attachments instead of reallocating.
+// The velocity texture of a target is only allocated once it is asked for.
+class MultisampleTargetCache
+{
+public:
+    MultisampleTargetCache()
+    {
+        attachedFBO = 0;
+        attached = NULL;
+        attachedSamples = 0;
+        attachedVelocity = 0;
+        maxSamples = 0;
+    }
+
+    // finds the target, creating it (or its velocity texture) on first use
+    // ------------------------------------------------------------------------
+    const MultisampleTarget& get(GLsizei samples, GLsizei width, GLsizei height, GLenum format, bool velocity)
+    {
+        // not every sample count of the quality combo is supported everywhere
+        if (maxSamples == 0)
+        {
+            GLint maxColorSamples = 0, maxDepthSamples = 0;
+            glGetIntegerv(GL_MAX_COLOR_TEXTURE_SAMPLES, &maxColorSamples);
+            glGetIntegerv(GL_MAX_DEPTH_TEXTURE_SAMPLES, &maxDepthSamples);
+            maxSamples = (GLsizei)std::min(maxColorSamples, maxDepthSamples);
+        }
+        GLsizei supported = std::min(samples, maxSamples);
+
+        MultisampleTarget* found = NULL;
+        for (const std::unique_ptr<MultisampleTarget>& target : targets)
+        {
+            if (target->samples == supported && target->width == width && target->height == height && target->format == format)
+                found = target.get();
+        }
+
+        if (found == NULL)
+        {
+            if (supported != samples)
+                std::cout << "ERROR::MSAA::SAMPLES_NOT_SUPPORTED: " << samples << "X, using " << supported << "X" << std::endl;
+
+            found = new MultisampleTarget{ 0, 0, 0, supported, width, height, format };
+            targets.push_back(std::unique_ptr<MultisampleTarget>(found));
+
+            glGenTextures(1, &found->colorTex);
+            glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, found->colorTex);
+            glTexStorage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, supported, format, width, height, GL_TRUE);
+
+            glGenTextures(1, &found->depthTex);
+            glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, found->depthTex);
+            glTexStorage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, supported, GL_DEPTH24_STENCIL8, width, height, GL_TRUE);
+        }
+        if (velocity && found->velocityTex == 0)
+        {
+            glGenTextures(1, &found->velocityTex);
+            glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, found->velocityTex);
+            glTexStorage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, supported, GL_RG16F, width, height, GL_TRUE);
+        }
+        glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, 0);
+        return *found;
+    }
+
+    // attaches the target to the framebuffer, with the velocity texture if asked for. Does
+    // nothing and returns false if the attached target still fits, which is checked without
+    // a lookup, so it is cheap enough to call every frame.
+    // ------------------------------------------------------------------------
+    bool attach(GLuint fbo, GLsizei samples, GLsizei width, GLsizei height, GLenum format, bool velocity)
+    {
+        if (width <= 0 || height <= 0)
+            return false; // minimized window
+
+        if (attached != NULL && attachedFBO == fbo && attachedSamples == samples && attached->width == width
+            && attached->height == height && attached->format == format && (!velocity || attachedVelocity != 0))
+            return false;
+
+        const MultisampleTarget& target = get(samples, width, height, format, velocity);
+        if (attachedFBO == fbo && attached == &target && attachedVelocity == target.velocityTex)
+        {
+            attachedSamples = samples;
+            return false;
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D_MULTISAMPLE, target.colorTex, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D_MULTISAMPLE, target.velocityTex, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D_MULTISAMPLE, target.depthTex, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::FRAMEBUFFER:: Multisampled framebuffer is not complete!" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        attachedFBO = fbo;
+        attached = &target;
+        attachedSamples = samples;
+        attachedVelocity = target.velocityTex;
+        return true;
+    }
+
+    // color texture of the attached target, e.g. to read its samples
+    GLuint attachedColorTexture() const { return attached != NULL ? attached->colorTex : 0; }
+    // whether the attached target has the velocity attachment, which a resolve can read
+    bool attachedHasVelocity() const { return attachedVelocity != 0; }
+
+    // drops the targets of every other size, e.g. after the window was resized
+    // ------------------------------------------------------------------------
+    void evict(GLsizei width, GLsizei height)
+    {
+        for (size_t i = 0; i < targets.size();)
+        {
+            MultisampleTarget& target = *targets[i];
+            if (target.width == width && target.height == height)
+            {
+                i++;
+                continue;
+            }
+            if (&target == attached)
+            {
+                attached = NULL;
+                attachedVelocity = 0;
+            }
+            deleteTextures(target);
+            targets.erase(targets.begin() + i);
+        }
+    }
+
+    void release()
+    {
+        for (const std::unique_ptr<MultisampleTarget>& target : targets)
+            deleteTextures(*target);
+        targets.clear();
+        attached = NULL;
+        attachedVelocity = 0;
+    }
+
+private:
+    std::vector<std::unique_ptr<MultisampleTarget>> targets;   // stay where they are, attached points into them
+    GLuint attachedFBO;
+    const MultisampleTarget* attached;
+    GLsizei attachedSamples;    // as asked for, the target may have fewer
+    GLuint attachedVelocity;
+    GLsizei maxSamples;     // of color and depth textures, 0 until queried
+
+    static void deleteTextures(MultisampleTarget& target)
+    {
+        glDeleteTextures(1, &target.colorTex);
+        if (target.velocityTex != 0)
+            glDeleteTextures(1, &target.velocityTex);
+        glDeleteTextures(1, &target.depthTex);
+    }
+};
+
+#endif
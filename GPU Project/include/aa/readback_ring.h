@@ -0,0 +1,250 @@
+#ifndef READBACK_RING_H
+#define READBACK_RING_H
+
+#include <aa/gl_ext.h>
+#include <aa/image_io.h>
+#include <aa/thread_pool.h>
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// number of frames that can be in flight between glReadPixels and the copy out of the buffer
+#define READBACK_RING_SLOTS 3
+
+// Reads frames back without stalling: glReadPixels goes into one of a ring of persistently
+// mapped pixel pack buffers, followed by a fence. Once the fence has signaled, a frame or two
+// later, a worker copies the pixels out of the mapping and passes them on to the consumer on
+// the same thread, e.g. to encode a PNG or compute metrics. The GL thread only issues the
+// read and polls the fences.
+//
+// A frame is dropped (and counted) when all slots are still busy, or when the consumers fall
+// so far behind that maxQueued images are waiting, which bounds the memory of a long capture.
+class ReadbackRing
+{
+public:
+    // called on a worker thread, rows in glReadPixels order; consumers of different frames can
+    // run at the same time, and must not wait for other jobs of the pool
+    typedef std::function<void(unsigned int frame, const RGBAImage& image)> Consumer;
+
+    explicit ReadbackRing(ThreadPool& pool = sharedThreadPool()) : pool(pool)
+    {
+        for (unsigned int i = 0; i < READBACK_RING_SLOTS; i++)
+        {
+            slots[i].buffer = 0;
+            slots[i].mapped = NULL;
+            slots[i].fence = 0;
+            slots[i].frame = 0;
+            slots[i].state = SLOT_FREE;
+        }
+        width = 0;
+        height = 0;
+        next = 0;
+        queued = 0;
+        maxQueued = pool.size() * 2 + 2;
+        droppedFrames = 0;
+    }
+
+    // allocates the buffers for frames of the given size, needs a current GL context
+    // ------------------------------------------------------------------------
+    bool init(int width, int height)
+    {
+        release();
+        GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        GLsizeiptr bytes = (GLsizeiptr)width * height * 4;
+        for (unsigned int i = 0; i < READBACK_RING_SLOTS; i++)
+        {
+            glGenBuffers(1, &slots[i].buffer);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, slots[i].buffer);
+            glBufferStorage(GL_PIXEL_PACK_BUFFER, bytes, NULL, flags);
+            slots[i].mapped = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, flags);
+            if (slots[i].mapped == NULL)
+            {
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+                std::cout << "ERROR::READBACK_RING::BUFFER_NOT_MAPPED" << std::endl;
+                release();
+                return false;
+            }
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        this->width = width;
+        this->height = height;
+        next = 0;
+        return true;
+    }
+
+    // waits for the frames in flight, then frees the buffers
+    void release()
+    {
+        finish();
+        for (unsigned int i = 0; i < READBACK_RING_SLOTS; i++)
+        {
+            if (slots[i].buffer != 0)
+            {
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, slots[i].buffer);
+                if (slots[i].mapped != NULL)
+                    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+                glDeleteBuffers(1, &slots[i].buffer);
+            }
+            slots[i].buffer = 0;
+            slots[i].mapped = NULL;
+        }
+        width = 0;
+        height = 0;
+    }
+
+    bool valid() const { return slots[0].mapped != NULL; }
+    int frameWidth() const { return width; }
+    int frameHeight() const { return height; }
+    unsigned int dropped() const { return droppedFrames; }
+    void resetDropped() { droppedFrames = 0; }
+
+    // queues the read of the color of framebuffer (0 is the back buffer), at the size given to
+    // init. Returns false if the frame had to be dropped.
+    // ------------------------------------------------------------------------
+    bool capture(GLuint framebuffer, unsigned int frame, const Consumer& consumer)
+    {
+        Slot& slot = slots[next];
+        if (stateOf(slot) != SLOT_FREE)
+        {
+            droppedFrames++;
+            return false;
+        }
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot.frame = frame;
+        slot.consumer = consumer;
+        std::lock_guard<std::mutex> lock(mutex);
+        slot.state = SLOT_READING;
+        next = (next + 1) % READBACK_RING_SLOTS;
+        return true;
+    }
+
+    // hands every read the GPU has finished to a worker, oldest first. With wait it also waits
+    // for the reads still in flight, which is meant for after glFinish or before release.
+    // ------------------------------------------------------------------------
+    void collect(bool wait = false)
+    {
+        for (unsigned int n = 0; n < READBACK_RING_SLOTS; n++)
+        {
+            // the slot after the last capture is the oldest
+            Slot& slot = slots[(next + n) % READBACK_RING_SLOTS];
+            if (stateOf(slot) != SLOT_READING)
+                continue;
+
+            GLenum status = glClientWaitSync(slot.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 1000000000 : 0);
+            if (status == GL_TIMEOUT_EXPIRED)
+                break;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                if (wait)
+                    consumed.wait(lock, [this] { return queued < maxQueued; });
+                else if (queued >= maxQueued)
+                    break; // the consumers are behind, the slot stays until they catch up
+                slot.state = SLOT_COPYING;
+                queued++;
+            }
+            glDeleteSync(slot.fence);
+            slot.fence = 0;
+
+            Slot* copied = &slot;
+            pool.submit([this, copied] { copy(*copied); });
+        }
+    }
+
+    // blocks until every read was handed on and every consumer has returned
+    void finish()
+    {
+        for (unsigned int i = 0; i < READBACK_RING_SLOTS; i++)
+        {
+            if (stateOf(slots[i]) == SLOT_READING)
+            {
+                collect(true);
+                break;
+            }
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        consumed.wait(lock, [this] { return queued == 0; });
+    }
+
+private:
+    enum SlotState {
+        SLOT_FREE,
+        SLOT_READING,       // glReadPixels issued, fence pending
+        SLOT_COPYING        // a worker is copying the pixels out
+    };
+
+    struct Slot
+    {
+        GLuint buffer;
+        const unsigned char* mapped;
+        GLsync fence;
+        unsigned int frame;
+        Consumer consumer;
+        SlotState state;
+    };
+
+    ThreadPool& pool;
+    Slot slots[READBACK_RING_SLOTS];
+    int width;
+    int height;
+    unsigned int next;                                  // slot of the next capture
+    unsigned int queued;                                // images copied out and not consumed yet
+    unsigned int maxQueued;
+    unsigned int droppedFrames;
+    std::vector<std::unique_ptr<RGBAImage>> images;     // recycled between frames
+    std::mutex mutex;
+    std::condition_variable consumed;
+
+    SlotState stateOf(const Slot& slot)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return slot.state;
+    }
+
+    // on a worker: frees the slot as soon as the pixels are out, then runs the consumer
+    void copy(Slot& slot)
+    {
+        std::unique_ptr<RGBAImage> image;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!images.empty())
+            {
+                image = std::move(images.back());
+                images.pop_back();
+            }
+        }
+        if (!image)
+            image.reset(new RGBAImage());
+        if (image->width != width || image->height != height)
+            image->resize(width, height);
+        std::memcpy(image->pixels.data(), slot.mapped, image->pixels.size());
+
+        unsigned int frame = slot.frame;
+        Consumer consumer = std::move(slot.consumer);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            slot.state = SLOT_FREE;
+        }
+
+        consumer(frame, *image);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        images.push_back(std::move(image));
+        queued--;
+        consumed.notify_all();
+    }
+};
+
+#endif
@@ -0,0 +1,341 @@
+#ifndef SCENE_BATCH_H
+#define SCENE_BATCH_H
+
+#include <aa/gl_ext.h>
+#include <learnopengl/mesh.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <vector>
+
+// where basicModel.vs/.fs expect the batch
+#define SCENE_BATCH_DRAW_ID_LOCATION 7      // instanced vertex attribute, the index of the draw
+#define SCENE_BATCH_MATERIAL_BINDING 0      // shader storage block, the diffuse layer of every draw
+#define SCENE_BATCH_TEXTURE_UNIT 1          // the texture array of the group being drawn
+
+// one command of the GL_DRAW_INDIRECT_BUFFER, as glMultiDrawElementsIndirect reads it
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// The meshes of a model as a few multi-draw-indirect calls instead of a draw with its own VAO
+// and texture bindings per mesh. The vertices and indices of every mesh are copied into one
+// vertex and one index buffer, and every mesh becomes a command of the indirect buffer. The
+// diffuse textures are copied into texture arrays, one per size and format, with the draws
+// sorted by array, so each array is bound once and drawn with a single call.
+//
+// The shader finds its layer in the material buffer, indexed by the draw: the base instance of
+// every command is its index, which comes in through an instanced attribute (gl_DrawID needs
+// GL 4.6). The textures have to be complete when the batch is built, as they are copied.
+class SceneBatch
+{
+public:
+    SceneBatch()
+    {
+        VAO = 0;
+        VBO = 0;
+        EBO = 0;
+        drawIdBuffer = 0;
+        indirectBuffer = 0;
+        materialBuffer = 0;
+    }
+
+    bool valid() const { return VAO != 0; }
+    size_t drawCount() const { return drawCountTotal; }
+    size_t groupCount() const { return groups.size(); }
+
+    // needs a current GL context, replaces an earlier batch
+    // ------------------------------------------------------------------------
+    bool build(const std::vector<Mesh>& meshes)
+    {
+        release();
+        if (meshes.empty())
+            return false;
+
+        // the diffuse texture of every mesh, the one Mesh::Draw binds as texture_diffuse1;
+        // meshes without one, or whose texture failed to load, share a white layer
+        std::vector<GLuint> diffuse(meshes.size(), 0);
+        std::map<GLuint, GroupKey> textureKeys;
+        for (size_t i = 0; i < meshes.size(); i++)
+        {
+            for (const Texture& texture : meshes[i].textures)
+            {
+                if (texture.type == "texture_diffuse")
+                {
+                    diffuse[i] = texture.id;
+                    break;
+                }
+            }
+            auto key = textureKeys.find(diffuse[i]);
+            if (key == textureKeys.end())
+                key = textureKeys.insert(std::make_pair(diffuse[i], textureKey(diffuse[i]))).first;
+            if (key->second.width == 0)
+                diffuse[i] = 0;
+        }
+
+        std::vector<GroupKey> keys;
+        std::vector<std::vector<GLuint>> layers;        // textures of each group, by layer
+        std::map<GLuint, std::pair<int, int>> slots;    // texture -> group, layer
+        std::vector<int> meshGroup(meshes.size());
+        std::vector<int> meshLayer(meshes.size());
+        for (size_t i = 0; i < meshes.size(); i++)
+        {
+            auto slot = slots.find(diffuse[i]);
+            if (slot == slots.end())
+            {
+                GroupKey key = diffuse[i] != 0 ? textureKeys[diffuse[i]] : textureKey(0);
+                size_t group = 0;
+                while (group < keys.size() && !(keys[group] == key))
+                    group++;
+                if (group == keys.size())
+                {
+                    keys.push_back(key);
+                    layers.push_back(std::vector<GLuint>());
+                }
+                slot = slots.insert(std::make_pair(diffuse[i], std::make_pair((int)group, (int)layers[group].size()))).first;
+                layers[group].push_back(diffuse[i]);
+            }
+            meshGroup[i] = slot->second.first;
+            meshLayer[i] = slot->second.second;
+        }
+
+        // the texture arrays, every mip level copied as it is
+        for (size_t g = 0; g < keys.size(); g++)
+        {
+            Group group;
+            group.firstCommand = 0;
+            group.commandCount = 0;
+            glGenTextures(1, &group.textureArray);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, group.textureArray);
+            glTexStorage3D(GL_TEXTURE_2D_ARRAY, keys[g].levels, keys[g].format, keys[g].width, keys[g].height, (GLsizei)layers[g].size());
+            for (size_t layer = 0; layer < layers[g].size(); layer++)
+            {
+                if (layers[g][layer] == 0)
+                {
+                    const unsigned char white[4] = { 255, 255, 255, 255 };
+                    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, (GLint)layer, 1, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, white);
+                    continue;
+                }
+                for (int level = 0; level < keys[g].levels; level++)
+                {
+                    GLsizei w = std::max(keys[g].width >> level, 1);
+                    GLsizei h = std::max(keys[g].height >> level, 1);
+                    glCopyImageSubData(layers[g][layer], GL_TEXTURE_2D, level, 0, 0, 0,
+                        group.textureArray, GL_TEXTURE_2D_ARRAY, level, 0, 0, (GLint)layer, w, h, 1);
+                }
+            }
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, keys[g].levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            groups.push_back(group);
+        }
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+        // one command per mesh, grouped by texture array; the command's index is its draw id
+        size_t vertexTotal = 0, indexTotal = 0;
+        std::vector<GLuint> firstVertex(meshes.size()), firstIndex(meshes.size());
+        for (size_t i = 0; i < meshes.size(); i++)
+        {
+            firstVertex[i] = (GLuint)vertexTotal;
+            firstIndex[i] = (GLuint)indexTotal;
+            vertexTotal += meshes[i].vertexCount;
+            indexTotal += meshes[i].indexCount;
+        }
+        std::vector<DrawElementsIndirectCommand> commands;
+        std::vector<GLuint> materials;
+        for (size_t g = 0; g < groups.size(); g++)
+        {
+            groups[g].firstCommand = (GLsizei)commands.size();
+            for (size_t i = 0; i < meshes.size(); i++)
+            {
+                if (meshGroup[i] != (int)g || meshes[i].indexCount == 0)
+                    continue;
+                DrawElementsIndirectCommand command;
+                command.count = meshes[i].indexCount;
+                command.instanceCount = 1;
+                command.firstIndex = firstIndex[i];
+                command.baseVertex = (GLint)firstVertex[i];
+                command.baseInstance = (GLuint)commands.size();
+                commands.push_back(command);
+                materials.push_back((GLuint)meshLayer[i]);
+            }
+            groups[g].commandCount = (GLsizei)commands.size() - groups[g].firstCommand;
+        }
+        drawCountTotal = commands.size();
+
+        // the meshes' own buffers are copied on the GPU, they aren't kept on the CPU
+        glGenBuffers(1, &VBO);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, VBO);
+        glBufferData(GL_COPY_WRITE_BUFFER, vertexTotal * sizeof(Vertex), NULL, GL_STATIC_DRAW);
+        for (size_t i = 0; i < meshes.size(); i++)
+        {
+            glBindBuffer(GL_COPY_READ_BUFFER, meshes[i].vertexBuffer());
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, firstVertex[i] * sizeof(Vertex), meshes[i].vertexCount * sizeof(Vertex));
+        }
+        glGenBuffers(1, &EBO);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, EBO);
+        glBufferData(GL_COPY_WRITE_BUFFER, indexTotal * sizeof(unsigned int), NULL, GL_STATIC_DRAW);
+        for (size_t i = 0; i < meshes.size(); i++)
+        {
+            glBindBuffer(GL_COPY_READ_BUFFER, meshes[i].indexBuffer());
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, firstIndex[i] * sizeof(unsigned int), meshes[i].indexCount * sizeof(unsigned int));
+        }
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        std::vector<GLuint> drawIds(commands.size());
+        for (size_t i = 0; i < drawIds.size(); i++)
+            drawIds[i] = (GLuint)i;
+        glGenBuffers(1, &drawIdBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, drawIdBuffer);
+        glBufferData(GL_ARRAY_BUFFER, drawIds.size() * sizeof(GLuint), drawIds.data(), GL_STATIC_DRAW);
+
+        glGenBuffers(1, &indirectBuffer);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+        glGenBuffers(1, &materialBuffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, materialBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, materials.size() * sizeof(GLuint), materials.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        // the attributes basicModel.vs reads, as in Mesh, and the draw id
+        glGenVertexArrays(1, &VAO);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+        glBindBuffer(GL_ARRAY_BUFFER, drawIdBuffer);
+        glEnableVertexAttribArray(SCENE_BATCH_DRAW_ID_LOCATION);
+        glVertexAttribIPointer(SCENE_BATCH_DRAW_ID_LOCATION, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+        glVertexAttribDivisor(SCENE_BATCH_DRAW_ID_LOCATION, 1);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        return true;
+    }
+
+    // every mesh, one glMultiDrawElementsIndirect per texture array
+    // ------------------------------------------------------------------------
+    void draw() const
+    {
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SCENE_BATCH_MATERIAL_BINDING, materialBuffer);
+        glActiveTexture(GL_TEXTURE0 + SCENE_BATCH_TEXTURE_UNIT);
+        for (const Group& group : groups)
+        {
+            if (group.commandCount == 0)
+                continue;
+            glBindTexture(GL_TEXTURE_2D_ARRAY, group.textureArray);
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                (const void*)(group.firstCommand * sizeof(DrawElementsIndirectCommand)), group.commandCount, 0);
+        }
+        glActiveTexture(GL_TEXTURE0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        glBindVertexArray(0);
+    }
+
+    void release()
+    {
+        for (const Group& group : groups)
+            glDeleteTextures(1, &group.textureArray);
+        groups.clear();
+        GLuint buffers[] = { VBO, EBO, drawIdBuffer, indirectBuffer, materialBuffer };
+        for (GLuint buffer : buffers)
+        {
+            if (buffer != 0)
+                glDeleteBuffers(1, &buffer);
+        }
+        if (VAO != 0)
+            glDeleteVertexArrays(1, &VAO);
+        VAO = 0;
+        VBO = 0;
+        EBO = 0;
+        drawIdBuffer = 0;
+        indirectBuffer = 0;
+        materialBuffer = 0;
+        drawCountTotal = 0;
+    }
+
+private:
+    // textures that can share an array
+    struct GroupKey
+    {
+        GLsizei width;
+        GLsizei height;
+        GLenum format;
+        GLsizei levels;
+
+        bool operator==(const GroupKey& other) const
+        {
+            return width == other.width && height == other.height && format == other.format && levels == other.levels;
+        }
+    };
+
+    struct Group
+    {
+        GLuint textureArray;
+        GLsizei firstCommand;
+        GLsizei commandCount;
+    };
+
+    GLuint VAO;
+    GLuint VBO;
+    GLuint EBO;
+    GLuint drawIdBuffer;
+    GLuint indirectBuffer;
+    GLuint materialBuffer;
+    std::vector<Group> groups;
+    size_t drawCountTotal = 0;
+
+    // size, format and mip levels of a texture made by the texture loader, the 1x1 white layer
+    // for no texture, a width of 0 for a texture that failed to load
+    static GroupKey textureKey(GLuint texture)
+    {
+        GroupKey key = { 1, 1, GL_RGBA8, 1 };
+        if (texture == 0)
+            return key;
+
+        GLint width = 0, height = 0, format = 0;
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &format);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        if (width == 0 || height == 0)
+        {
+            key.width = 0;
+            return key;
+        }
+
+        // TextureFromFile asks for unsized formats, the array needs the sized ones they stand for
+        switch (format)
+        {
+        case GL_RED: format = GL_R8; break;
+        case GL_RG: format = GL_RG8; break;
+        case GL_RGB: format = GL_RGB8; break;
+        case GL_RGBA: format = GL_RGBA8; break;
+        }
+        key.width = width;
+        key.height = height;
+        key.format = (GLenum)format;
+        key.levels = (GLsizei)std::floor(std::log2((double)std::max(width, height))) + 1; // glGenerateMipmap's chain
+        return key;
+    }
+};
+
+#endif
@@ -0,0 +1,145 @@
+#ifndef SMAA_COMPUTE_H
+#define SMAA_COMPUTE_H
+
+#include <aa/gl_ext.h>
+#include <learnopengl/compute_shader.h>
+
+#include <memory>
+#include <vector>
+
+// The three SMAA passes as compute shaders, next to the fragment shader passes in main.cpp.
+// Edge detection appends every pixel with an edge to a list in a storage buffer, the blending
+// weight pass is dispatched indirectly over that list only, and neighborhood blending reads
+// its 3x3 neighbourhoods from tiles in shared memory. The programs read the post-process
+// parameter block (binding 0) like the fragment versions.
+class SMAACompute
+{
+public:
+    SMAACompute()
+    {
+        edgeList = 0;
+        edgeListPixels = 0;
+    }
+
+    // needs a current GL context; one edge detection and blending weight program per preset
+    // ------------------------------------------------------------------------
+    void init(const char* const* presetDefines, int presetCount)
+    {
+        for (int preset = 0; preset < presetCount; preset++)
+        {
+            edgePrograms.push_back(ComputeShader("shader/smaaEdge.cs", presetDefines[preset]));
+            weightPrograms.push_back(ComputeShader("shader/smaaBlendWeight.cs", presetDefines[preset]));
+            weightPrograms.back().use();
+            weightPrograms.back().setVec4("subsampleIndices", glm::vec4(0.0f)); // SMAA 1x
+        }
+        blendProgram.reset(new ComputeShader("shader/smaaNeighbor.cs"));
+
+        glGenBuffers(1, &edgeList);
+    }
+
+    void release()
+    {
+        if (edgeList != 0)
+            glDeleteBuffers(1, &edgeList);
+        edgeList = 0;
+        edgeListPixels = 0;
+
+        for (ComputeShader& program : edgePrograms)
+            glDeleteProgram(program.ID);
+        for (ComputeShader& program : weightPrograms)
+            glDeleteProgram(program.ID);
+        if (blendProgram)
+            glDeleteProgram(blendProgram->ID);
+        edgePrograms.clear();
+        weightPrograms.clear();
+        blendProgram.reset();
+    }
+
+    // the edge list has room for every pixel, so it has to grow with the framebuffer
+    // ------------------------------------------------------------------------
+    void resize(int width, int height)
+    {
+        size_t pixels = (size_t)std::max(width, 0) * std::max(height, 0);
+        if (edgeList == 0 || pixels <= edgeListPixels)
+            return;
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, edgeList);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, EDGE_LIST_HEADER + pixels * sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        edgeListPixels = pixels;
+    }
+
+    // writes the edges of every pixel to edgeTex and collects the edge pixels
+    // ------------------------------------------------------------------------
+    void detectEdges(int preset, GLuint colorTex, GLuint edgeTex, int width, int height)
+    {
+        resize(width, height);
+
+        // the blending weight pass starts with no work groups and an empty list
+        const GLuint emptyList[4] = { 0, 1, 1, 0 };
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, edgeList);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(emptyList), emptyList);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, edgeList);
+
+        edgePrograms[preset].use();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, colorTex);
+        glBindImageTexture(0, edgeTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+        glDispatchCompute(ComputeShader::groups(width, 8), ComputeShader::groups(height, 8), 1);
+
+        // edgeTex is sampled, the list read and its dispatch arguments used by the next pass
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+    }
+
+    // weights of the listed pixels only; blendTex has to be cleared to zero before
+    // ------------------------------------------------------------------------
+    void computeWeights(int preset, GLuint edgeTex, GLuint areaTex, GLuint searchTex, GLuint blendTex)
+    {
+        weightPrograms[preset].use();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, edgeTex);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, areaTex);
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, searchTex);
+        glBindImageTexture(0, blendTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, edgeList);
+        glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, edgeList);
+        glDispatchComputeIndirect(0);
+        glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    }
+
+    // writes the antialiased image to outputTex
+    // ------------------------------------------------------------------------
+    void blend(GLuint colorTex, GLuint blendTex, GLuint outputTex, int width, int height)
+    {
+        blendProgram->use();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, colorTex);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, blendTex);
+        glBindImageTexture(0, outputTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+        glDispatchCompute(ComputeShader::groups(width, 16), ComputeShader::groups(height, 16), 1);
+
+        // the output is sampled (TAA) or blitted next
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+private:
+    // groupsX, groupsY, groupsZ, edgeCount in front of the pixels, see shader/smaaEdge.cs
+    static const size_t EDGE_LIST_HEADER = 4 * sizeof(GLuint);
+
+    std::vector<ComputeShader> edgePrograms;
+    std::vector<ComputeShader> weightPrograms;
+    std::unique_ptr<ComputeShader> blendProgram;
+
+    GLuint edgeList;
+    size_t edgeListPixels;  // capacity of the list
+};
+
+#endif
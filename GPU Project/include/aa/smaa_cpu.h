@@ -0,0 +1,628 @@
+#ifndef SMAA_CPU_H
+#define SMAA_CPU_H
+
+#include <AreaTex.h>
+#include <SearchTex.h>
+#include <aa/image_io.h>
+#include <aa/thread_pool.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+// the layout of AreaTex, as in SMAA.glsl
+#define SMAA_CPU_AREATEX_MAX_DISTANCE 16
+#define SMAA_CPU_AREATEX_MAX_DISTANCE_DIAG 20
+
+// SMAA 1x on the CPU, a port of the three passes of SMAA.glsl as the fragment path builds them:
+// luma edge detection, blending weights with the orthogonal and diagonal searches and corner
+// detection, and neighborhood blending. Like the shaders it works in GL orientation (row 0 at
+// the bottom, SMAA_FLIP_Y), so "top" is the next row in memory. The texture units are emulated:
+// the edges are read with bilinear filtering and clamp to edge, AreaTex bilinear and SearchTex
+// nearest, both with repeat, straight from the byte arrays (main.cpp uploads them flipped and
+// the shaders flip the coordinates back). Positions are in pixels instead of texcoords.
+//
+// Each pass runs over bands of rows on the thread pool, the next pass starts when all bands
+// are done. Edges take 2 bits per pixel, the weights 4 bytes like the RGBA8 blend texture, so
+// they are quantized the same way.
+
+// the values SMAA.glsl compiles in for SMAA_PRESET_*
+struct SMAACpuSettings
+{
+    float threshold;
+    int maxSearchSteps;
+    int maxSearchStepsDiag;     // 0 disables the diagonal search
+    int cornerRounding;         // -1 disables the corner detection
+};
+
+const SMAACpuSettings smaaCpuPresets[4] =
+{
+    { 0.15f, 4, 0, -1 },        // low
+    { 0.10f, 8, 0, -1 },        // medium
+    { 0.10f, 16, 8, 25 },       // high
+    { 0.05f, 32, 16, 25 }       // ultra
+};
+
+class SMAACpu
+{
+public:
+    explicit SMAACpu(ThreadPool* pool = &sharedThreadPool(), int bandHeight = 32)
+        : pool(pool), bandHeight(std::max(bandHeight, 1))
+    {
+        width = 0;
+        height = 0;
+        edgeStride = 0;
+        source = NULL;
+        settings = smaaCpuPresets[3];
+    }
+
+    // runs the three passes on source into target, which is resized to match. The buffers are
+    // kept between calls, so a batch of images of one size allocates once.
+    // ------------------------------------------------------------------------
+    void run(const RGBAImage& source, RGBAImage& target, const SMAACpuSettings& settings)
+    {
+        this->source = &source;
+        this->settings = settings;
+        width = source.width;
+        height = source.height;
+        edgeStride = (width + 3) / 4;
+        luma.resize((size_t)width * height);
+        edges.assign((size_t)edgeStride * height, 0);
+        weights.assign((size_t)width * height * 4, 0);
+        target.resize(width, height);
+        if (width == 0 || height == 0)
+            return;
+
+        forBands([this](int y0, int y1) { lumaPass(y0, y1); });
+        forBands([this](int y0, int y1) { edgePass(y0, y1); });
+        forBands([this](int y0, int y1) { weightPass(y0, y1); });
+        forBands([this, &target](int y0, int y1) { blendPass(target, y0, y1); });
+    }
+
+    // the intermediate results of the last run as the GL textures hold them: edges in r (left)
+    // and g (top) of edgeTex, blending weights as in blendTex
+    // ------------------------------------------------------------------------
+    void edgeImage(RGBAImage& image) const
+    {
+        image.resize(width, height);
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                int e = edgeBits(x, y);
+                unsigned char* pixel = image.row(y) + x * 4;
+                pixel[0] = (e & 1) ? 255 : 0;
+                pixel[1] = (e & 2) ? 255 : 0;
+                pixel[3] = 255;
+            }
+        }
+    }
+
+    void weightImage(RGBAImage& image) const
+    {
+        image.width = width;
+        image.height = height;
+        image.pixels = weights;
+    }
+
+private:
+    struct Float2
+    {
+        float x, y;
+    };
+
+    ThreadPool* pool;
+    int bandHeight;
+    int width;
+    int height;
+    int edgeStride;                         // bytes per row of edges
+    std::vector<float> luma;
+    std::vector<unsigned char> edges;       // 2 bits per pixel: bit 0 left, bit 1 top
+    std::vector<unsigned char> weights;     // RGBA8 per pixel
+    const RGBAImage* source;
+    SMAACpuSettings settings;
+
+    void forBands(const std::function<void(int, int)>& job)
+    {
+        parallelRows(pool, height, bandHeight, job);
+    }
+
+    static float saturate(float v) { return std::min(std::max(v, 0.0f), 1.0f); }
+    static float roundHalfUp(float v) { return std::floor(v + 0.5f); }
+
+    int edgeBits(int x, int y) const
+    {
+        return (edges[(size_t)y * edgeStride + (x >> 2)] >> ((x & 3) * 2)) & 3;
+    }
+
+    // SMAASampleLevelZero(edgesTex, p).rg with p in pixels
+    Float2 sampleEdges(float px, float py) const
+    {
+        float u = px - 0.5f;
+        float v = py - 0.5f;
+        float u0 = std::floor(u);
+        float v0 = std::floor(v);
+        float fx = u - u0;
+        float fy = v - v0;
+        int x0 = std::min(std::max((int)u0, 0), width - 1);
+        int x1 = std::min(std::max((int)u0 + 1, 0), width - 1);
+        int y0 = std::min(std::max((int)v0, 0), height - 1);
+        int y1 = std::min(std::max((int)v0 + 1, 0), height - 1);
+
+        int a = edgeBits(x0, y0), b = edgeBits(x1, y0), c = edgeBits(x0, y1), d = edgeBits(x1, y1);
+        float wa = (1.0f - fx) * (1.0f - fy), wb = fx * (1.0f - fy), wc = (1.0f - fx) * fy, wd = fx * fy;
+        Float2 e;
+        e.x = ((a & 1) ? wa : 0.0f) + ((b & 1) ? wb : 0.0f) + ((c & 1) ? wc : 0.0f) + ((d & 1) ? wd : 0.0f);
+        e.y = ((a & 2) ? wa : 0.0f) + ((b & 2) ? wb : 0.0f) + ((c & 2) ? wc : 0.0f) + ((d & 2) ? wd : 0.0f);
+        return e;
+    }
+
+    // AreaTex (RG8) with bilinear filtering and repeat, s in texels with the centers at .5
+    static Float2 sampleArea(float sx, float sy)
+    {
+        float u = sx - 0.5f;
+        float v = sy - 0.5f;
+        float u0 = std::floor(u);
+        float v0 = std::floor(v);
+        float fx = u - u0;
+        float fy = v - v0;
+        auto wrap = [](int i, int size) { return ((i % size) + size) % size; };
+        int x0 = wrap((int)u0, AREATEX_WIDTH), x1 = wrap((int)u0 + 1, AREATEX_WIDTH);
+        int y0 = wrap((int)v0, AREATEX_HEIGHT), y1 = wrap((int)v0 + 1, AREATEX_HEIGHT);
+
+        Float2 area;
+        for (int channel = 0; channel < 2; channel++)
+        {
+            float a = areaTexBytes[y0 * AREATEX_PITCH + x0 * 2 + channel];
+            float b = areaTexBytes[y0 * AREATEX_PITCH + x1 * 2 + channel];
+            float c = areaTexBytes[y1 * AREATEX_PITCH + x0 * 2 + channel];
+            float d = areaTexBytes[y1 * AREATEX_PITCH + x1 * 2 + channel];
+            float top = a + (b - a) * fx;
+            float bottom = c + (d - c) * fx;
+            (channel == 0 ? area.x : area.y) = (top + (bottom - top) * fy) / 255.0f;
+        }
+        return area;
+    }
+
+    // SearchTex (R8) with nearest filtering and repeat
+    static float sampleSearch(float sx, float sy)
+    {
+        int x = (((int)std::floor(sx) % SEARCHTEX_WIDTH) + SEARCHTEX_WIDTH) % SEARCHTEX_WIDTH;
+        int y = (((int)std::floor(sy) % SEARCHTEX_HEIGHT) + SEARCHTEX_HEIGHT) % SEARCHTEX_HEIGHT;
+        return searchTexBytes[y * SEARCHTEX_PITCH + x] / 255.0f;
+    }
+
+    // first pass
+    // ------------------------------------------------------------------------
+    void lumaPass(int y0, int y1)
+    {
+        for (int y = y0; y < y1; y++)
+        {
+            const unsigned char* row = source->row(y);
+            float* out = luma.data() + (size_t)y * width;
+            for (int x = 0; x < width; x++)
+                out[x] = row[x * 4] / 255.0f * 0.2126f + row[x * 4 + 1] / 255.0f * 0.7152f + row[x * 4 + 2] / 255.0f * 0.0722f;
+        }
+    }
+
+    float lumaAt(int x, int y) const
+    {
+        x = std::min(std::max(x, 0), width - 1);
+        y = std::min(std::max(y, 0), height - 1);
+        return luma[(size_t)y * width + x];
+    }
+
+    // SMAALumaEdgeDetectionPS; a row of edges is a row of bytes, so bands never share one
+    void edgePass(int y0, int y1)
+    {
+        const float threshold = settings.threshold;
+        for (int y = y0; y < y1; y++)
+        {
+            unsigned char* row = edges.data() + (size_t)y * edgeStride;
+            for (int x = 0; x < width; x++)
+            {
+                float L = lumaAt(x, y);
+                float Lleft = lumaAt(x - 1, y);
+                float Ltop = lumaAt(x, y + 1);
+                float deltaX = std::fabs(L - Lleft);
+                float deltaY = std::fabs(L - Ltop);
+                bool edgeX = deltaX >= threshold;
+                bool edgeY = deltaY >= threshold;
+                if (!edgeX && !edgeY)
+                    continue;
+
+                float Lright = lumaAt(x + 1, y);
+                float Lbottom = lumaAt(x, y - 1);
+                float maxDeltaX = std::max(deltaX, std::fabs(L - Lright));
+                float maxDeltaY = std::max(deltaY, std::fabs(L - Lbottom));
+
+                float Lleftleft = lumaAt(x - 2, y);
+                float Ltoptop = lumaAt(x, y + 2);
+                maxDeltaX = std::max(maxDeltaX, std::fabs(Lleft - Lleftleft));
+                maxDeltaY = std::max(maxDeltaY, std::fabs(Ltop - Ltoptop));
+                float finalDelta = std::max(maxDeltaX, maxDeltaY);
+
+                // local contrast adaptation, SMAA_LOCAL_CONTRAST_ADAPTATION_FACTOR is 2
+                edgeX = edgeX && 2.0f * deltaX >= finalDelta;
+                edgeY = edgeY && 2.0f * deltaY >= finalDelta;
+                row[x >> 2] |= (unsigned char)(((edgeX ? 1 : 0) | (edgeY ? 2 : 0)) << ((x & 3) * 2));
+            }
+        }
+    }
+
+    // second pass
+    // ------------------------------------------------------------------------
+    static Float2 decodeDiagBilinearAccess(Float2 e)
+    {
+        e.x = e.x * std::fabs(5.0f * e.x - 5.0f * 0.75f);
+        e.x = roundHalfUp(e.x);
+        e.y = roundHalfUp(e.y);
+        return e;
+    }
+
+    // SMAASearchDiag1 and 2, dir in SMAA's y-down sense; returns (distance, last edge found)
+    Float2 searchDiag(float px, float py, float dirX, float dirY, bool bilinearPair, Float2& e) const
+    {
+        dirY = -dirY;
+        float x = px + (bilinearPair ? 0.25f : 0.0f);
+        float y = py;
+        float z = -1.0f;
+        float w = 1.0f;
+        while (z < (float)(settings.maxSearchStepsDiag - 1) && w > 0.9f)
+        {
+            x += dirX;
+            y += dirY;
+            z += 1.0f;
+            e = sampleEdges(x, y);
+            if (bilinearPair)
+                e = decodeDiagBilinearAccess(e);
+            w = e.x * 0.5f + e.y * 0.5f;
+        }
+        Float2 result = { z, w };
+        return result;
+    }
+
+    static Float2 areaDiag(Float2 dist, Float2 e, float offset)
+    {
+        float tx = (float)SMAA_CPU_AREATEX_MAX_DISTANCE_DIAG * e.x + dist.x;
+        float ty = (float)SMAA_CPU_AREATEX_MAX_DISTANCE_DIAG * e.y + dist.y;
+        // the diagonal areas are in the right half, each subsample offset has its own 80 rows
+        return sampleArea(tx + 0.5f + AREATEX_WIDTH / 2, ty + 0.5f + AREATEX_HEIGHT / 7.0f * offset);
+    }
+
+    Float2 calculateDiagWeights(float px, float py, Float2 e) const
+    {
+        Float2 weights = { 0.0f, 0.0f };
+        Float2 end = { 0.0f, 0.0f };
+        float dx, dy, dz, dw;
+
+        if (e.x > 0.0f)
+        {
+            Float2 d = searchDiag(px, py, -1.0f, 1.0f, false, end);
+            dx = d.x + (end.y > 0.9f ? 1.0f : 0.0f);
+            dz = d.y;
+        }
+        else
+        {
+            dx = 0.0f;
+            dz = 0.0f;
+        }
+        Float2 d = searchDiag(px, py, 1.0f, -1.0f, false, end);
+        dy = d.x;
+        dw = d.y;
+
+        if (dx + dy > 2.0f)
+        {
+            float c0x = px - dx + 0.25f, c0y = py - dx;
+            float c1x = px + dy, c1y = py + dy + 0.25f;
+            Float2 left = sampleEdges(c0x - 1.0f, c0y);
+            Float2 right = sampleEdges(c1x + 1.0f, c1y);
+            // c.yxwz = decode(c.xyzw)
+            Float2 decodedLeft = decodeDiagBilinearAccess(left);
+            Float2 decodedRight = decodeDiagBilinearAccess(right);
+            float cx = decodedLeft.y, cy = decodedLeft.x, cz = decodedRight.y, cw = decodedRight.x;
+
+            Float2 cc = { 2.0f * cx + cy, 2.0f * cz + cw };
+            if (dz >= 0.9f)
+                cc.x = 0.0f;
+            if (dw >= 0.9f)
+                cc.y = 0.0f;
+
+            Float2 dist = { dx, dy };
+            Float2 area = areaDiag(dist, cc, 0.0f);
+            weights.x += area.x;
+            weights.y += area.y;
+        }
+
+        d = searchDiag(px, py, -1.0f, -1.0f, true, end);
+        dx = d.x;
+        dz = d.y;
+        if (sampleEdges(px + 1.0f, py).x > 0.0f)
+        {
+            d = searchDiag(px, py, 1.0f, 1.0f, true, end);
+            dy = d.x + (end.y > 0.9f ? 1.0f : 0.0f);
+            dw = d.y;
+        }
+        else
+        {
+            dy = 0.0f;
+            dw = 0.0f;
+        }
+
+        if (dx + dy > 2.0f)
+        {
+            float c0x = px - dx, c0y = py + dx;
+            float c1x = px + dy, c1y = py - dy;
+            float cx = sampleEdges(c0x - 1.0f, c0y).y;
+            float cy = sampleEdges(c0x, c0y + 1.0f).x;
+            Float2 right = sampleEdges(c1x + 1.0f, c1y);
+            float cz = right.y, cw = right.x;
+
+            Float2 cc = { 2.0f * cx + cy, 2.0f * cz + cw };
+            if (dz >= 0.9f)
+                cc.x = 0.0f;
+            if (dw >= 0.9f)
+                cc.y = 0.0f;
+
+            Float2 dist = { dx, dy };
+            Float2 area = areaDiag(dist, cc, 0.0f);
+            weights.x += area.y;
+            weights.y += area.x;
+        }
+        return weights;
+    }
+
+    static float searchLength(Float2 e, float offset)
+    {
+        // SMAASearchLength in texels of the 64x16 packed texture
+        float sx = 32.0f * e.x + 66.0f * offset + 0.5f;
+        float sy = -32.0f * e.y + 32.5f;
+        return sampleSearch(sx, sy);
+    }
+
+    float searchXLeft(float x, float y, float end) const
+    {
+        Float2 e = { 0.0f, 1.0f };
+        while (x > end && e.y > 0.8281f && e.x == 0.0f)
+        {
+            e = sampleEdges(x, y);
+            x -= 2.0f;
+        }
+        float offset = -(255.0f / 127.0f) * searchLength(e, 0.0f) + 3.25f;
+        return x + offset;
+    }
+
+    float searchXRight(float x, float y, float end) const
+    {
+        Float2 e = { 0.0f, 1.0f };
+        while (x < end && e.y > 0.8281f && e.x == 0.0f)
+        {
+            e = sampleEdges(x, y);
+            x += 2.0f;
+        }
+        float offset = -(255.0f / 127.0f) * searchLength(e, 0.5f) + 3.25f;
+        return x - offset;
+    }
+
+    float searchYUp(float x, float y, float end) const
+    {
+        Float2 e = { 1.0f, 0.0f };
+        while (y < end && e.x > 0.8281f && e.y == 0.0f)
+        {
+            e = sampleEdges(x, y);
+            y += 2.0f;
+        }
+        Float2 gr = { e.y, e.x };
+        float offset = -(255.0f / 127.0f) * searchLength(gr, 0.0f) + 3.25f;
+        return y - offset;
+    }
+
+    float searchYDown(float x, float y, float end) const
+    {
+        Float2 e = { 1.0f, 0.0f };
+        while (y > end && e.x > 0.8281f && e.y == 0.0f)
+        {
+            e = sampleEdges(x, y);
+            y -= 2.0f;
+        }
+        Float2 gr = { e.y, e.x };
+        float offset = -(255.0f / 127.0f) * searchLength(gr, 0.5f) + 3.25f;
+        return y + offset;
+    }
+
+    static Float2 area(Float2 dist, float e1, float e2, float offset)
+    {
+        float tx = (float)SMAA_CPU_AREATEX_MAX_DISTANCE * roundHalfUp(4.0f * e1) + dist.x;
+        float ty = (float)SMAA_CPU_AREATEX_MAX_DISTANCE * roundHalfUp(4.0f * e2) + dist.y;
+        return sampleArea(tx + 0.5f, ty + 0.5f + AREATEX_HEIGHT / 7.0f * offset);
+    }
+
+    Float2 cornerRounding(Float2 d) const
+    {
+        Float2 leftRight = { d.y >= d.x ? 1.0f : 0.0f, d.x >= d.y ? 1.0f : 0.0f };
+        float norm = 1.0f - settings.cornerRounding / 100.0f;
+        Float2 rounding = { norm * leftRight.x, norm * leftRight.y };
+        // reduce blending for pixels in the center of a line
+        rounding.x /= leftRight.x + leftRight.y;
+        rounding.y /= leftRight.x + leftRight.y;
+        return rounding;
+    }
+
+    void detectHorizontalCornerPattern(Float2& weights, float x0, float x1, float y, Float2 d) const
+    {
+        if (settings.cornerRounding < 0)
+            return;
+        Float2 rounding = cornerRounding(d);
+        Float2 factor = { 1.0f, 1.0f };
+        factor.x -= rounding.x * sampleEdges(x0, y - 1.0f).x;
+        factor.x -= rounding.y * sampleEdges(x1 + 1.0f, y - 1.0f).x;
+        factor.y -= rounding.x * sampleEdges(x0, y + 2.0f).x;
+        factor.y -= rounding.y * sampleEdges(x1 + 1.0f, y + 2.0f).x;
+        weights.x *= saturate(factor.x);
+        weights.y *= saturate(factor.y);
+    }
+
+    void detectVerticalCornerPattern(Float2& weights, float x, float y0, float y1, Float2 d) const
+    {
+        if (settings.cornerRounding < 0)
+            return;
+        Float2 rounding = cornerRounding(d);
+        Float2 factor = { 1.0f, 1.0f };
+        factor.x -= rounding.x * sampleEdges(x + 1.0f, y0).y;
+        factor.x -= rounding.y * sampleEdges(x + 1.0f, y1 - 1.0f).y;
+        factor.y -= rounding.x * sampleEdges(x - 2.0f, y0).y;
+        factor.y -= rounding.y * sampleEdges(x - 2.0f, y1 - 1.0f).y;
+        weights.x *= saturate(factor.x);
+        weights.y *= saturate(factor.y);
+    }
+
+    // SMAABlendingWeightCalculationPS with zero subsample indices, only on pixels with an edge
+    // like the stencil test of the fragment path
+    void weightPass(int y0, int y1)
+    {
+        const float steps = (float)settings.maxSearchSteps;
+        for (int y = y0; y < y1; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                int bits = edgeBits(x, y);
+                if (bits == 0)
+                    continue;
+
+                float px = x + 0.5f;
+                float py = y + 0.5f;
+                Float2 e = { (bits & 1) ? 1.0f : 0.0f, (bits & 2) ? 1.0f : 0.0f };
+                float weights[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+                if (e.y > 0.0f) // edge at north
+                {
+                    Float2 diag = { 0.0f, 0.0f };
+                    if (settings.maxSearchStepsDiag > 0)
+                        diag = calculateDiagWeights(px, py, e);
+                    weights[0] = diag.x;
+                    weights[1] = diag.y;
+
+                    // diagonals take priority
+                    if (diag.x == -diag.y)
+                    {
+                        float left = searchXLeft(px - 0.25f, py + 0.125f, px - 0.25f - 2.0f * steps);
+                        float crossY = py + 0.25f;
+                        float e1 = sampleEdges(left, crossY).x;
+                        float right = searchXRight(px + 1.25f, py + 0.125f, px + 1.25f + 2.0f * steps);
+                        Float2 d = { std::fabs(roundHalfUp(left - px)), std::fabs(roundHalfUp(right - px)) };
+                        Float2 sqrtD = { std::sqrt(d.x), std::sqrt(d.y) };
+                        float e2 = sampleEdges(right + 1.0f, crossY).x;
+
+                        Float2 w = area(sqrtD, e1, e2, 0.0f);
+                        detectHorizontalCornerPattern(w, left, right, py, d);
+                        weights[0] = w.x;
+                        weights[1] = w.y;
+                    }
+                    else
+                        e.x = 0.0f; // skip vertical processing
+                }
+
+                if (e.x > 0.0f) // edge at west
+                {
+                    float up = searchYUp(px - 0.125f, py + 0.25f, py + 0.25f + 2.0f * steps);
+                    float crossX = px - 0.25f;
+                    float e1 = sampleEdges(crossX, up).y;
+                    float down = searchYDown(px - 0.125f, py - 1.25f, py - 1.25f - 2.0f * steps);
+                    Float2 d = { std::fabs(roundHalfUp(up - py)), std::fabs(roundHalfUp(down - py)) };
+                    Float2 sqrtD = { std::sqrt(d.x), std::sqrt(d.y) };
+                    float e2 = sampleEdges(crossX, down - 1.0f).y;
+
+                    Float2 w = area(sqrtD, e1, e2, 0.0f);
+                    detectVerticalCornerPattern(w, px, up, down, d);
+                    weights[2] = w.x;
+                    weights[3] = w.y;
+                }
+
+                unsigned char* out = this->weights.data() + ((size_t)y * width + x) * 4;
+                for (int i = 0; i < 4; i++)
+                    out[i] = (unsigned char)(saturate(weights[i]) * 255.0f + 0.5f);
+            }
+        }
+    }
+
+    // third pass
+    // ------------------------------------------------------------------------
+    float weightAt(int x, int y, int channel) const
+    {
+        x = std::min(std::max(x, 0), width - 1);
+        y = std::min(std::max(y, 0), height - 1);
+        return weights[((size_t)y * width + x) * 4 + channel] / 255.0f;
+    }
+
+    // bilinear read of the source, accumulated into color with the given weight
+    void addColor(float px, float py, float weight, float* color) const
+    {
+        float u = px - 0.5f;
+        float v = py - 0.5f;
+        float u0 = std::floor(u);
+        float v0 = std::floor(v);
+        float fx = u - u0;
+        float fy = v - v0;
+        int x0 = std::min(std::max((int)u0, 0), width - 1);
+        int x1 = std::min(std::max((int)u0 + 1, 0), width - 1);
+        int y0 = std::min(std::max((int)v0, 0), height - 1);
+        int y1 = std::min(std::max((int)v0 + 1, 0), height - 1);
+
+        const unsigned char* a = source->row(y0) + x0 * 4;
+        const unsigned char* b = source->row(y0) + x1 * 4;
+        const unsigned char* c = source->row(y1) + x0 * 4;
+        const unsigned char* d = source->row(y1) + x1 * 4;
+        for (int i = 0; i < 4; i++)
+        {
+            float top = a[i] + (b[i] - a[i]) * fx;
+            float bottom = c[i] + (d[i] - c[i]) * fx;
+            color[i] += weight * (top + (bottom - top) * fy) / 255.0f;
+        }
+    }
+
+    // SMAANeighborhoodBlendingPS
+    void blendPass(RGBAImage& target, int y0, int y1) const
+    {
+        for (int y = y0; y < y1; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                float right = weightAt(x + 1, y, 3);
+                float top = weightAt(x, y - 1, 1);
+                float left = weightAt(x, y, 2);
+                float bottom = weightAt(x, y, 0);
+                unsigned char* out = target.row(y) + x * 4;
+
+                if (right + top + left + bottom < 1e-5f)
+                {
+                    std::memcpy(out, source->row(y) + x * 4, 4);
+                    continue;
+                }
+
+                // blend with the neighbour across the strongest edge, horizontally or vertically
+                float px = x + 0.5f;
+                float py = y + 0.5f;
+                bool h = std::max(right, left) > std::max(top, bottom);
+                float color[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+                if (h)
+                {
+                    float sum = right + left;
+                    addColor(px + right, py, right / sum, color);
+                    addColor(px - left, py, left / sum, color);
+                }
+                else
+                {
+                    float sum = top + bottom;
+                    addColor(px, py - top, top / sum, color);
+                    addColor(px, py + bottom, bottom / sum, color);
+                }
+                for (int i = 0; i < 4; i++)
+                    out[i] = (unsigned char)(saturate(color[i]) * 255.0f + 0.5f);
+            }
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef SMAA_MODES_H
+#define SMAA_MODES_H
+
+#include <aa/jitter.h>
+
+#include <glm/glm.hpp>
+
+// SMAA modes of the fragment path, numbered the same way as the SMAA Mode combo in the
+// Control Panel:
+//   1x   SMAA on the scene
+//   T2x  1x on a jittered scene, resolved with the last frame by the TAA pass
+//   S2x  1x on each sample of a 2x multisampled scene, the two results averaged
+//   4x   S2x on a jittered scene, resolved with the last frame by the TAA pass
+enum SMAAMode {
+    SMAA_MODE_1X = 0,
+    SMAA_MODE_T2X = 1,
+    SMAA_MODE_S2X = 2,
+    SMAA_MODE_4X = 3
+};
+
+const char* const smaaModeNames[] = { "1X", "T2X", "S2X", "4X" };
+
+inline bool smaaModeTemporal(int mode)
+{
+    return mode == SMAA_MODE_T2X || mode == SMAA_MODE_4X;
+}
+
+inline bool smaaModeSpatial(int mode)
+{
+    return mode == SMAA_MODE_S2X || mode == SMAA_MODE_4X;
+}
+
+// camera jitter of the temporal modes
+inline int smaaModeJitter(int mode)
+{
+    return mode == SMAA_MODE_4X ? JITTER_SMAA_4X : JITTER_T2X;
+}
+
+// subsampleIndices of the blending weight pass, see @SUBSAMPLE_INDICES in SMAA.h. jitterIndex is
+// the position of the frame's jitter in its sequence, sample the S2x sample in the order of the
+// table (S0 is offset by (0.25, -0.25) with y pointing up).
+// ------------------------------------------------------------------------
+inline glm::vec4 smaaSubsampleIndices(int mode, unsigned int jitterIndex, int sample)
+{
+    switch (mode)
+    {
+    case SMAA_MODE_T2X:
+        // jitterOffset(JITTER_T2X) starts with (-0.25, 0.25), which is S1
+        return jitterIndex % 2 == 0 ? glm::vec4(2.0f, 2.0f, 2.0f, 0.0f) : glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
+    case SMAA_MODE_S2X:
+        return sample == 0 ? glm::vec4(1.0f, 1.0f, 1.0f, 0.0f) : glm::vec4(2.0f, 2.0f, 2.0f, 0.0f);
+    case SMAA_MODE_4X:
+    {
+        // frame 0 is jittered by (0.125, 0.125), frame 1 by (-0.125, -0.125)
+        const glm::vec4 indices[2][2] = {
+            { glm::vec4(5.0f, 3.0f, 1.0f, 3.0f), glm::vec4(4.0f, 6.0f, 2.0f, 3.0f) },
+            { glm::vec4(3.0f, 5.0f, 1.0f, 4.0f), glm::vec4(6.0f, 4.0f, 2.0f, 4.0f) }
+        };
+        return indices[jitterIndex % 2][sample];
+    }
+    default:
+        return glm::vec4(0.0f); // 1x
+    }
+}
+
+// edge detection of the fragment path, numbered the same way as the SMAA Edge Detection combo.
+// Depth needs a single fetch per neighbour and catches geometric edges only; predicated is luma
+// with a lower threshold where the depth has an edge too.
+enum SMAAEdgeMethod {
+    SMAA_EDGE_LUMA = 0,
+    SMAA_EDGE_COLOR = 1,
+    SMAA_EDGE_DEPTH = 2,
+    SMAA_EDGE_PREDICATED = 3,
+    SMAA_EDGE_METHOD_COUNT
+};
+
+const char* const smaaEdgeMethodNames[] = { "LUMA", "COLOR", "DEPTH", "PREDICATED" };
+
+// compiled into the edge detection programs, EDGEMETHOD of smaaEdge.fs is 0 color, 1 luma, 2 depth
+const char* const smaaEdgeMethodDefines[] = {
+    "#define EDGEMETHOD 1\n",
+    "#define EDGEMETHOD 0\n",
+    "#define EDGEMETHOD 2\n",
+    "#define EDGEMETHOD 1\n#define SMAA_PREDICATION 1\n"
+};
+
+inline bool smaaEdgeMethodUsesDepth(int method)
+{
+    return method == SMAA_EDGE_DEPTH || method == SMAA_EDGE_PREDICATED;
+}
+
+#endif
@@ -0,0 +1,199 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <glad/glad.h>
+// model.h includes the stb_image implementation, which must not be pulled in a second time
+#ifndef STBI_INCLUDE_STB_IMAGE_H
+#include <stb_image.h>
+#endif
+
+#include <aa/thread_pool.h>
+#include <aa/upload_ring.h>
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+
+// an image decoded by a worker, waiting for its upload on the GL thread
+struct DecodedImage
+{
+    GLuint texture;
+    std::string path;
+    unsigned char* pixels;
+    int width;
+    int height;
+    int components;
+};
+
+// Decodes image files on the worker pool and uploads them on the GL thread. request() hands
+// out the texture name right away, so meshes can refer to it before its pixels are there.
+// With an upload ring the pixels are streamed through it, and uploadReady() can spread the
+// uploads over several frames.
+class TextureLoader
+{
+public:
+    explicit TextureLoader(ThreadPool& pool = sharedThreadPool()) : pool(pool)
+    {
+        pending = 0;
+        ring = NULL;
+    }
+
+    void setUploadRing(UploadRing* ring) { this->ring = ring; }
+
+    ~TextureLoader() { finish(); }
+
+    TextureLoader(const TextureLoader&) = delete;
+    TextureLoader& operator=(const TextureLoader&) = delete;
+
+    // starts decoding the file, only call from the GL thread
+    // ------------------------------------------------------------------------
+    GLuint request(const std::string& path)
+    {
+        GLuint texture;
+        glGenTextures(1, &texture);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending++;
+        }
+        pool.submit([this, texture, path] {
+            DecodedImage image = { texture, path, NULL, 0, 0, 0 };
+            image.pixels = stbi_load(path.c_str(), &image.width, &image.height, &image.components, 0);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            decoded.push_back(image);
+            imageDecoded.notify_one();
+        });
+        return texture;
+    }
+
+    // uploads images that are decoded by now, up to about the given number of bytes or
+    // until the upload ring is full. Returns how many images are still outstanding.
+    // ------------------------------------------------------------------------
+    unsigned int uploadReady(size_t byteBudget = (size_t)-1)
+    {
+        size_t uploaded = 0;
+        DecodedImage image;
+        while (uploaded < byteBudget && pop(image, false))
+        {
+            if (!upload(image, false))
+            {
+                // the ring is still in use, the image goes first next time
+                std::lock_guard<std::mutex> lock(mutex);
+                decoded.push_front(image);
+                pending++;
+                break;
+            }
+            uploaded += imageBytes(image);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        return pending;
+    }
+
+    // uploads every requested image, in the order they finish decoding
+    void finish()
+    {
+        DecodedImage image;
+        while (pop(image, true))
+            upload(image, true);
+    }
+
+private:
+    ThreadPool& pool;
+    std::mutex mutex;
+    std::condition_variable imageDecoded;
+    std::deque<DecodedImage> decoded;
+    unsigned int pending;   // requested and not uploaded yet
+    UploadRing* ring;
+
+    bool pop(DecodedImage& image, bool wait)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (wait)
+            imageDecoded.wait(lock, [this] { return !decoded.empty() || pending == 0; });
+        if (decoded.empty())
+            return false;
+
+        image = decoded.front();
+        decoded.pop_front();
+        pending--;
+        return true;
+    }
+
+    static size_t imageBytes(const DecodedImage& image)
+    {
+        return (size_t)image.width * image.height * image.components;
+    }
+
+    // returns false if the image has to wait for room in the upload ring
+    bool upload(DecodedImage& image, bool wait)
+    {
+        if (image.pixels == NULL)
+        {
+            std::cout << "Texture failed to load at path: " << image.path << std::endl;
+            return true;
+        }
+
+        // images larger than the whole ring are uploaded from client memory
+        size_t bytes = imageBytes(image);
+        bool streamed = ring != NULL && ring->valid() && ring->fits(bytes);
+        GLintptr offset = 0;
+        if (streamed && !ring->allocate(bytes, wait, offset))
+        {
+            if (!wait)
+                return false;
+            streamed = false;
+        }
+
+        GLenum format = GL_RGBA;
+        GLenum internalFormat = GL_RGBA8;
+        if (image.components == 1)
+        {
+            format = GL_RED;
+            internalFormat = GL_R8;
+        }
+        else if (image.components == 2)
+        {
+            format = GL_RG;
+            internalFormat = GL_RG8;
+        }
+        else if (image.components == 3)
+        {
+            format = GL_RGB;
+            internalFormat = GL_RGB8;
+        }
+
+        // the size is only known once the image is decoded, so the storage is allocated here,
+        // once, with the whole mip chain, and the pixels are a sub-upload into it
+        GLsizei levels = (GLsizei)std::floor(std::log2((double)std::max(image.width, image.height))) + 1;
+        glBindTexture(GL_TEXTURE_2D, image.texture);
+        glTexStorage2D(GL_TEXTURE_2D, levels, internalFormat, image.width, image.height);
+        if (streamed)
+        {
+            std::memcpy(ring->pointer(offset), image.pixels, bytes);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ring->id());
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image.width, image.height, format, GL_UNSIGNED_BYTE, (void*)offset);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            ring->fence(offset, bytes);
+        }
+        else
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image.width, image.height, format, GL_UNSIGNED_BYTE, image.pixels);
+        glGenerateMipmap(GL_TEXTURE_2D);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        stbi_image_free(image.pixels);
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads running jobs in submission order. Jobs must not touch GL,
+// the context is only current on the main thread.
+class ThreadPool
+{
+public:
+    explicit ThreadPool(unsigned int threads = 0)
+    {
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+
+        stopping = false;
+        running = 0;
+        for (unsigned int i = 0; i < threads; i++)
+            workers.emplace_back([this] { work(); });
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        jobAdded.notify_all();
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned int size() const { return (unsigned int)workers.size(); }
+
+    void submit(std::function<void()> job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(std::move(job));
+        }
+        jobAdded.notify_one();
+    }
+
+    // blocks until every submitted job has finished
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this] { return jobs.empty() && running == 0; });
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable jobAdded;
+    std::condition_variable idle;
+    unsigned int running;
+    bool stopping;
+
+    void work()
+    {
+        while (true)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                jobAdded.wait(lock, [this] { return stopping || !jobs.empty(); });
+                if (jobs.empty())
+                    return;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+                running++;
+            }
+
+            job();
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                running--;
+                if (jobs.empty() && running == 0)
+                    idle.notify_all();
+            }
+        }
+    }
+};
+
+// pool with one worker per hardware thread, shared by everything that loads or processes in the background
+inline ThreadPool& sharedThreadPool()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+// runs job(y0, y1) for bands of bandHeight rows out of rows on the pool and waits for them, which
+// wait() can't do while other work is queued. Without a pool the whole range runs here.
+// ------------------------------------------------------------------------
+inline void parallelRows(ThreadPool* pool, int rows, int bandHeight, const std::function<void(int, int)>& job)
+{
+    if (pool == NULL)
+    {
+        job(0, rows);
+        return;
+    }
+
+    std::mutex mutex;
+    std::condition_variable bandsDone;
+    int remaining = (rows + bandHeight - 1) / bandHeight;
+    for (int y = 0; y < rows; y += bandHeight)
+    {
+        int y1 = std::min(y + bandHeight, rows);
+        pool->submit([&, y, y1] {
+            job(y, y1);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--remaining == 0)
+                bandsDone.notify_all();
+        });
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    bandsDone.wait(lock, [&] { return remaining == 0; });
+}
+
+#endif
@@ -0,0 +1,137 @@
+#ifndef UPLOAD_RING_H
+#define UPLOAD_RING_H
+
+#include <aa/gl_ext.h>
+
+#include <deque>
+#include <iostream>
+
+// A persistently mapped pixel unpack buffer used as a ring for texture uploads. Pixels are
+// copied into the ring and uploaded from the buffer offset, so the driver can do the
+// transfer asynchronously. Every allocation is guarded by a fence, a region is only
+// written again once the GPU has finished reading it.
+class UploadRing
+{
+public:
+    UploadRing()
+    {
+        buffer = 0;
+        mapped = NULL;
+        size = 0;
+        head = 0;
+    }
+
+    // needs a current GL context
+    bool init(GLsizeiptr bytes)
+    {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+        glBufferStorage(GL_PIXEL_UNPACK_BUFFER, bytes, NULL, flags);
+        mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, flags);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        if (mapped == NULL)
+        {
+            std::cout << "ERROR::UPLOAD_RING::BUFFER_NOT_MAPPED" << std::endl;
+            release();
+            return false;
+        }
+
+        size = bytes;
+        head = 0;
+        return true;
+    }
+
+    void release()
+    {
+        for (Region& region : regions)
+            glDeleteSync(region.fence);
+        regions.clear();
+
+        if (buffer != 0)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+            if (mapped != NULL)
+                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            glDeleteBuffers(1, &buffer);
+        }
+        buffer = 0;
+        mapped = NULL;
+        size = 0;
+    }
+
+    bool valid() const { return mapped != NULL; }
+    bool fits(size_t bytes) const { return (GLsizeiptr)bytes <= size; }
+    GLuint id() const { return buffer; }
+    unsigned char* pointer(GLintptr offset) const { return mapped + offset; }
+
+    // finds room for the given number of bytes after the last allocation, wrapping around at
+    // the end. Returns false if the GPU is still reading that part (try again later), unless
+    // wait is set, then it blocks until the GPU is done with it.
+    // ------------------------------------------------------------------------
+    bool allocate(size_t bytes, bool wait, GLintptr& offset)
+    {
+        if (!fits(bytes))
+            return false;
+
+        offset = (head + 255) & ~(GLintptr)255;
+        if (offset + (GLsizeiptr)bytes > size)
+            offset = 0;
+
+        // after a wrap the newest regions sit at the start of the ring and the older ones at
+        // its end, so every region in flight is checked, not only the oldest ones
+        for (auto region = regions.begin(); region != regions.end();)
+        {
+            bool overlaps = offset < region->offset + region->size && region->offset < offset + (GLintptr)bytes;
+            GLenum status = glClientWaitSync(region->fence, 0, 0);
+            if (overlaps && status == GL_TIMEOUT_EXPIRED)
+            {
+                if (!wait)
+                    return false;
+                while (status == GL_TIMEOUT_EXPIRED)
+                    status = glClientWaitSync(region->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+            }
+            if (status == GL_WAIT_FAILED)
+            {
+                std::cout << "ERROR::UPLOAD_RING::WAIT_FAILED" << std::endl;
+                return false;
+            }
+            if (status == GL_TIMEOUT_EXPIRED)
+            {
+                region++;
+                continue;
+            }
+
+            glDeleteSync(region->fence);
+            region = regions.erase(region);
+        }
+
+        head = offset + (GLsizeiptr)bytes;
+        return true;
+    }
+
+    // call after the commands reading the allocation were issued
+    void fence(GLintptr offset, size_t bytes)
+    {
+        Region region = { offset, (GLsizeiptr)bytes, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) };
+        regions.push_back(region);
+    }
+
+private:
+    struct Region
+    {
+        GLintptr offset;
+        GLsizeiptr size;
+        GLsync fence;
+    };
+
+    GLuint buffer;
+    unsigned char* mapped;
+    GLsizeiptr size;
+    GLintptr head;                  // where the next allocation starts
+    std::deque<Region> regions;     // in flight, in the order they were fenced
+};
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef COMPUTE_SHADER_H
+#define COMPUTE_SHADER_H
+
+#include <learnopengl/shader.h>
+#include <aa/gl_ext.h>
+
+// A program made of a single compute shader. Loading (#include, defines) and the uniform
+// functions are the same as for Shader.
+class ComputeShader : public Shader
+{
+public:
+    ComputeShader(const char* computePath, const std::string& defines = "")
+    {
+        std::string computeCode;
+        std::ifstream cShaderFile;
+        cShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
+        try
+        {
+            cShaderFile.open(computePath);
+            std::stringstream cShaderStream;
+            cShaderStream << cShaderFile.rdbuf();
+            cShaderFile.close();
+            computeCode = injectDefines(resolveIncludes(cShaderStream.str(), computePath), defines);
+        }
+        catch (std::ifstream::failure& e)
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << e.what() << std::endl;
+        }
+        const char* cShaderCode = computeCode.c_str();
+
+        unsigned int compute = glCreateShader(GL_COMPUTE_SHADER);
+        glShaderSource(compute, 1, &cShaderCode, NULL);
+        glCompileShader(compute);
+        checkCompileErrors(compute, "COMPUTE");
+
+        ID = glCreateProgram();
+        glAttachShader(ID, compute);
+        glLinkProgram(ID);
+        checkCompileErrors(ID, "PROGRAM");
+        glDeleteShader(compute);
+
+        reflectUniforms();
+    }
+
+    // number of work groups of groupSize invocations needed for size invocations
+    // ------------------------------------------------------------------------
+    static GLuint groups(int size, int groupSize)
+    {
+        return (GLuint)((size + groupSize - 1) / groupSize);
+    }
+};
+#endif
@@ -13,6 +13,9 @@
 
 #include <learnopengl/mesh.h>
 #include <learnopengl/shader.h>
+#include <aa/mesh_cache.h>
+#include <aa/scene_batch.h>
+#include <aa/texture_loader.h>
 
 #include <string>
 #include <fstream>
@@ -32,38 +35,116 @@ public:
     vector<Mesh>    meshes;
     string directory;
     bool gammaCorrection;
+    // the meshes as multi-draw-indirect batches, built by the owner once the textures are complete
+    SceneBatch batch;
 
     // constructor, expects a filepath to a 3D model.
-    Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+    // with a streamer the textures keep coming in after the constructor returned, as the owner
+    // of the streamer uploads them.
+    Model(string const &path, bool gamma = false, TextureLoader *streamer = NULL) : gammaCorrection(gamma)
     {
+        // the textures are decoded on the worker threads while the meshes are set up
+        TextureLoader loader;
+        textureLoader = streamer ? streamer : &loader;
         loadModel(path);
+        loader.finish();
+        textureLoader = NULL;
     }
 
-    // draws the model, and thus all its meshes
+    // draws the model, and thus all its meshes; with the batch in a few calls. The caller
+    // tells the shader which of the two it gets (batched in basicModel.vs/.fs).
     void Draw(Shader &shader)
     {
+        if (batch.valid())
+        {
+            batch.draw();
+            return;
+        }
         for(unsigned int i = 0; i < meshes.size(); i++)
             meshes[i].Draw(shader);
     }
     
 private:
+    TextureLoader *textureLoader = NULL;   // only set while the model is loading
+
     // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
+    // the imported meshes are cached next to the model file, so later runs skip ASSIMP entirely.
     void loadModel(string const &path)
     {
+        const unsigned int importFlags = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
+
+        // retrieve the directory path of the filepath
+        directory = path.substr(0, path.find_last_of('/'));
+
+        // the cache is only valid for the exact source file it was made from
+        uint64_t sourceHash = 0;
+        {
+            MappedFile source;
+            if (source.open(path.c_str()))
+                sourceHash = hashBytes(source.bytes(), source.length());
+        }
+        string cachePath = path + ".meshcache";
+        if (loadMeshCache(cachePath, sourceHash, importFlags))
+            return;
+
         // read file via ASSIMP
         Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+        const aiScene* scene = importer.ReadFile(path, importFlags);
         // check for errors
         if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
         {
             cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
             return;
         }
-        // retrieve the directory path of the filepath
-        directory = path.substr(0, path.find_last_of('/'));
 
         // process ASSIMP's root node recursively
         processNode(scene->mRootNode, scene);
+
+        writeMeshCache(cachePath, sourceHash, importFlags, meshes, textures_loaded);
+    }
+
+    // loads the meshes from a mesh cache written by an earlier run; the vertex and index data
+    // is uploaded straight from the mapped file.
+    bool loadMeshCache(string const &cachePath, uint64_t sourceHash, unsigned int importFlags)
+    {
+        MappedFile file;
+        if (!file.open(cachePath.c_str()))
+            return false;
+        const MeshCacheHeader* header = validateMeshCache(file, sourceHash, importFlags);
+        if (!header)
+        {
+            cout << "mesh cache out of date: " << cachePath << endl;
+            return false;
+        }
+
+        const unsigned char* bytes = file.bytes();
+        const MeshCacheMesh* cacheMeshes = (const MeshCacheMesh*)(bytes + header->meshOffset);
+        const MeshCacheTexture* cacheTextures = (const MeshCacheTexture*)(bytes + header->textureOffset);
+        const uint32_t* textureRefs = (const uint32_t*)(bytes + header->textureRefOffset);
+        const char* strings = (const char*)(bytes + header->stringOffset);
+        const Vertex* vertices = (const Vertex*)(bytes + header->vertexOffset);
+        const unsigned int* indices = (const unsigned int*)(bytes + header->indexOffset);
+
+        for (uint32_t i = 0; i < header->textureCount; i++)
+        {
+            Texture texture;
+            texture.type = string(strings + cacheTextures[i].typeOffset, cacheTextures[i].typeLength);
+            texture.path = string(strings + cacheTextures[i].pathOffset, cacheTextures[i].pathLength);
+            texture.id = textureLoader->request(this->directory + '/' + texture.path);
+            textures_loaded.push_back(texture);
+        }
+
+        for (uint32_t i = 0; i < header->meshCount; i++)
+        {
+            const MeshCacheMesh& cacheMesh = cacheMeshes[i];
+            vector<Texture> textures;
+            for (uint32_t j = 0; j < cacheMesh.textureRefCount; j++)
+                textures.push_back(textures_loaded[textureRefs[cacheMesh.firstTextureRef + j]]);
+
+            meshes.push_back(Mesh(vertices + cacheMesh.firstVertex, cacheMesh.vertexCount,
+                indices + cacheMesh.firstIndex, cacheMesh.indexCount, textures));
+        }
+        return true;
     }
 
     // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
@@ -192,7 +273,7 @@ private:
             if(!skip)
             {   // if texture hasn't been loaded already, load it
                 Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
+                texture.id = textureLoader->request(this->directory + '/' + str.C_Str());
                 texture.type = typeName;
                 texture.path = str.C_Str();
                 textures.push_back(texture);
@@ -8,6 +8,30 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <algorithm>
+
+// glUniform* for every type a Uniform handle can have
+// ------------------------------------------------------------------------
+inline void setUniformValue(GLint location, bool value) { glUniform1i(location, (int)value); }
+inline void setUniformValue(GLint location, int value) { glUniform1i(location, value); }
+inline void setUniformValue(GLint location, float value) { glUniform1f(location, value); }
+inline void setUniformValue(GLint location, const glm::vec2 &value) { glUniform2fv(location, 1, &value[0]); }
+inline void setUniformValue(GLint location, const glm::vec3 &value) { glUniform3fv(location, 1, &value[0]); }
+inline void setUniformValue(GLint location, const glm::vec4 &value) { glUniform4fv(location, 1, &value[0]); }
+inline void setUniformValue(GLint location, const glm::mat2 &mat) { glUniformMatrix2fv(location, 1, GL_FALSE, &mat[0][0]); }
+inline void setUniformValue(GLint location, const glm::mat3 &mat) { glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]); }
+inline void setUniformValue(GLint location, const glm::mat4 &mat) { glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]); }
+
+// a uniform location looked up once, typed by the value it is set with. Like the set* functions
+// of Shader it applies to the program that is in use.
+template <typename T>
+struct Uniform
+{
+    GLint location = -1;
+
+    void set(const T &value) const { setUniformValue(location, value); }
+};
 
 class Shader
 {
@@ -15,7 +39,8 @@ public:
     unsigned int ID;
     // constructor generates the shader on the fly
     // ------------------------------------------------------------------------
-    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
+    // defines (lines like "#define X 1\n") are put in front of every stage, right after #version
+    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr, const std::string& defines = "")
     {
         // 1. retrieve the vertex/fragment source code from filePath
         std::string vertexCode;
@@ -41,8 +66,8 @@ public:
             vShaderFile.close();
             fShaderFile.close();
             // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();			
+            vertexCode = injectDefines(resolveIncludes(vShaderStream.str(), vertexPath), defines);
+            fragmentCode = injectDefines(resolveIncludes(fShaderStream.str(), fragmentPath), defines);
             // if geometry shader path is present, also load a geometry shader
             if(geometryPath != nullptr)
             {
@@ -50,7 +75,7 @@ public:
                 std::stringstream gShaderStream;
                 gShaderStream << gShaderFile.rdbuf();
                 gShaderFile.close();
-                geometryCode = gShaderStream.str();
+                geometryCode = injectDefines(resolveIncludes(gShaderStream.str(), geometryPath), defines);
             }
         }
         catch (std::ifstream::failure& e)
@@ -95,6 +120,7 @@ public:
         if(geometryPath != nullptr)
             glDeleteShader(geometry);
 
+        reflectUniforms();
     }
     // activate the shader
     // ------------------------------------------------------------------------
@@ -102,66 +128,181 @@ public:
     { 
         glUseProgram(ID); 
     }
+    // location of an active uniform from the table built at link time, -1 if there is none
+    // ------------------------------------------------------------------------
+    GLint location(const std::string &name) const
+    {
+        auto it = std::lower_bound(uniforms.begin(), uniforms.end(), name,
+            [](const std::pair<std::string, GLint> &entry, const std::string &key) { return entry.first < key; });
+        if (it == uniforms.end() || it->first != name)
+            return -1;
+        return it->second;
+    }
+    // handle for the per-frame path, which then needs no name lookups at all
+    template <typename T>
+    Uniform<T> uniform(const std::string &name) const
+    {
+        Uniform<T> handle;
+        handle.location = location(name);
+        return handle;
+    }
     // utility uniform functions
     // ------------------------------------------------------------------------
     void setBool(const std::string &name, bool value) const
     {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+        glUniform1i(location(name), (int)value); 
     }
     // ------------------------------------------------------------------------
     void setInt(const std::string &name, int value) const
     { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1i(location(name), value); 
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string &name, float value) const
     { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1f(location(name), value); 
     }
     // ------------------------------------------------------------------------
     void setVec2(const std::string &name, const glm::vec2 &value) const
     { 
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform2fv(location(name), 1, &value[0]); 
     }
     void setVec2(const std::string &name, float x, float y) const
     { 
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+        glUniform2f(location(name), x, y); 
     }
     // ------------------------------------------------------------------------
     void setVec3(const std::string &name, const glm::vec3 &value) const
     { 
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform3fv(location(name), 1, &value[0]); 
     }
     void setVec3(const std::string &name, float x, float y, float z) const
     { 
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+        glUniform3f(location(name), x, y, z); 
     }
     // ------------------------------------------------------------------------
     void setVec4(const std::string &name, const glm::vec4 &value) const
     { 
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform4fv(location(name), 1, &value[0]); 
     }
     void setVec4(const std::string &name, float x, float y, float z, float w) 
     { 
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+        glUniform4f(location(name), x, y, z, w); 
     }
     // ------------------------------------------------------------------------
     void setMat2(const std::string &name, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix2fv(location(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat3(const std::string &name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix3fv(location(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat4(const std::string &name, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix4fv(location(name), 1, GL_FALSE, &mat[0][0]);
+    }
+
+protected:
+    // for the derived shader kinds, which build the program themselves
+    Shader() : ID(0) {}
+
+    // every active uniform with its location, sorted by name
+    std::vector<std::pair<std::string, GLint>> uniforms;
+
+    // reads all active uniforms of the linked program; arrays are listed as "name[0]",
+    // they are entered under both names and every further element under its own
+    // ------------------------------------------------------------------------
+    void reflectUniforms()
+    {
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<GLchar> nameBuffer(std::max(maxLength, 1));
+        for (GLint i = 0; i < count; i++)
+        {
+            GLint size;
+            GLenum type;
+            glGetActiveUniform(ID, (GLuint)i, (GLsizei)nameBuffer.size(), NULL, &size, &type, nameBuffer.data());
+            std::string name = nameBuffer.data();
+            GLint uniformLocation = glGetUniformLocation(ID, name.c_str());
+            if (uniformLocation < 0)
+                continue; // lives in a uniform block
+
+            uniforms.push_back(std::make_pair(name, uniformLocation));
+            if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+            {
+                std::string base = name.substr(0, name.size() - 3);
+                uniforms.push_back(std::make_pair(base, uniformLocation));
+                for (GLint element = 1; element < size; element++)
+                {
+                    std::string elementName = base + "[" + std::to_string(element) + "]";
+                    uniforms.push_back(std::make_pair(elementName, glGetUniformLocation(ID, elementName.c_str())));
+                }
+            }
+        }
+        std::sort(uniforms.begin(), uniforms.end());
+    }
+
+    // replaces every line '#include "file"' with the contents of the file, which is looked up
+    // next to the including one. GLSL has no include of its own.
+    // ------------------------------------------------------------------------
+    static std::string resolveIncludes(const std::string &code, const std::string &path, int depth = 0)
+    {
+        if (depth > 16)
+        {
+            std::cout << "ERROR::SHADER::INCLUDE_TOO_DEEP: " << path << std::endl;
+            return code;
+        }
+        std::string directory = path.substr(0, path.find_last_of("/\\") + 1);
+
+        std::stringstream result;
+        std::istringstream lines(code);
+        std::string line;
+        while (std::getline(lines, line))
+        {
+            size_t start = line.find_first_not_of(" \t");
+            size_t open = line.find('"');
+            size_t close = line.find('"', open + 1);
+            if (start == std::string::npos || line.compare(start, 8, "#include") != 0
+                || open == std::string::npos || close == std::string::npos)
+            {
+                result << line << '\n';
+                continue;
+            }
+
+            std::string includePath = directory + line.substr(open + 1, close - open - 1);
+            std::ifstream includeFile(includePath);
+            if (!includeFile)
+            {
+                std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << includePath << std::endl;
+                continue;
+            }
+            std::stringstream includeStream;
+            includeStream << includeFile.rdbuf();
+            result << resolveIncludes(includeStream.str(), includePath, depth + 1) << '\n';
+        }
+        return result.str();
+    }
+
+    // #version has to stay the first statement, so the defines go on the line after it
+    // ------------------------------------------------------------------------
+    static std::string injectDefines(const std::string &code, const std::string &defines)
+    {
+        if (defines.empty())
+            return code;
+
+        size_t version = code.find("#version");
+        if (version == std::string::npos)
+            return defines + code;
+        size_t lineEnd = code.find('\n', version);
+        if (lineEnd == std::string::npos)
+            return code + "\n" + defines;
+        return code.substr(0, lineEnd + 1) + defines + code.substr(lineEnd + 1);
     }
 
-private:
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)
@@ -1,11 +1,17 @@
 #version 330 core
-out vec4 FragColor;
+layout (location = 0) out vec4 FragColor;
+layout (location = 1) out vec2 Velocity;
 
 in vec2 TexCoord;
+in vec4 CurrPosition;
+in vec4 PrevPosition;
 
 uniform sampler2D textureImage; // ؽó 
 
 void main()
 {
     FragColor = texture(textureImage, TexCoord); // ؽó Ͽ  
+
+    // screen space motion since the last frame, in texture coordinates
+    Velocity = (CurrPosition.xy / CurrPosition.w - PrevPosition.xy / PrevPosition.w) * 0.5;
 }
\ No newline at end of file
@@ -3,13 +3,23 @@ layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTexCoord;
 
 out vec2 TexCoord;
+out vec4 CurrPosition;
+out vec4 PrevPosition;
 
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
+// view-projection of this and the last frame without the TAA jitter, for the motion vectors
+uniform mat4 currViewProj;
+uniform mat4 prevViewProj;
+
 void main()
 {
     gl_Position = projection * view * model * vec4(aPos, 1.0);
     TexCoord = aTexCoord;
+
+    vec4 worldPos = model * vec4(aPos, 1.0);
+    CurrPosition = currViewProj * worldPos;
+    PrevPosition = prevViewProj * worldPos;
 }
\ No newline at end of file
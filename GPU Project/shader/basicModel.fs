@@ -1,11 +1,23 @@
-#version 330 core
-out vec4 FragColor;
+#version 430 core
+layout (location = 0) out vec4 FragColor;
+layout (location = 1) out vec2 Velocity;
 
 in vec2 TexCoords;
+in vec4 CurrPosition;
+in vec4 PrevPosition;
+flat in float Layer;
 
 uniform sampler2D texture_diffuse1;
+layout (binding = 1) uniform sampler2DArray texture_diffuse_array;
+uniform bool batched;
 
 void main()
 {    
-    FragColor = texture(texture_diffuse1, TexCoords);
+    if (batched)
+        FragColor = texture(texture_diffuse_array, vec3(TexCoords, Layer));
+    else
+        FragColor = texture(texture_diffuse1, TexCoords);
+
+    // screen space motion since the last frame, in texture coordinates
+    Velocity = (CurrPosition.xy / CurrPosition.w - PrevPosition.xy / PrevPosition.w) * 0.5;
 }
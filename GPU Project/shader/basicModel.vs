@@ -1,17 +1,38 @@
-#version 330 core
+#version 430 core
 
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+// batched: the index of the draw, the base instance of its indirect command
+layout (location = 7) in uint aDrawID;
+
+// batched: the layer of every draw's diffuse texture in the bound texture array
+layout (std430, binding = 0) readonly buffer SceneMaterials
+{
+    uint materialLayer[];
+};
 
 out vec2 TexCoords;
+out vec4 CurrPosition;
+out vec4 PrevPosition;
+flat out float Layer;
 
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+uniform bool batched;
+
+// view-projection of this and the last frame without the TAA jitter, for the motion vectors
+uniform mat4 currViewProj;
+uniform mat4 prevViewProj;
 
 void main()
 {
     TexCoords = aTexCoords;    
+    Layer = batched ? float(materialLayer[aDrawID]) : 0.0;
     gl_Position = projection * view * model * vec4(aPos, 1.0);
+
+    vec4 worldPos = model * vec4(aPos, 1.0);
+    CurrPosition = currViewProj * worldPos;
+    PrevPosition = prevViewProj * worldPos;
 }
\ No newline at end of file
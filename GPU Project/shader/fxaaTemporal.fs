@@ -0,0 +1,35 @@
+#version 450 core
+#define FXAA_PC 1
+#define FXAA_GLSL_130 1
+
+#define FXAA_GREEN_AS_LUMA 1
+
+#include "FXAA.glsl"
+
+#include "postprocess.glsl"
+#include "taa.glsl"
+
+// FXAA and the TAA resolve in one pass: the FXAA result of the pixel goes straight into the
+// temporal blend, which is written to the screen and, through an image store, to the history
+// texture of the next frame. Drawn with fxaa_demo.vs.
+
+uniform sampler2D colorTex;
+uniform sampler2D previousTex;
+uniform sampler2D velocityTex;
+layout (rgba16f) writeonly uniform image2D historyImage;
+
+in vec2 texcoord;
+
+out vec4 outColor;
+
+void main(void)
+{
+    // same settings as fxaa_demo.fs
+    vec4 zero = vec4(0.0, 0.0, 0.0, 0.0);
+    vec4 current = FxaaPixelShader(texcoord, zero, colorTex, colorTex, colorTex, screenSize.xy, zero, zero, zero, 0.75, 0.166, 0.0833, 8.0, 0.125, 0.05, zero);
+
+    // the history is clamped to the scene around the pixel, the FXAA result of the
+    // neighbours is not known here
+    outColor = taaResolve(current, texcoord, colorTex, previousTex, velocityTex);
+    imageStore(historyImage, ivec2(gl_FragCoord.xy), outColor);
+}
@@ -0,0 +1,23 @@
+// Parameters shared by every anti-aliasing pass, one std140 uniform buffer bound to binding 0.
+// Must match PostProcessParameters in main.cpp.
+layout(std140, binding = 0) uniform PostProcessParameters
+{
+    vec4 screenSize;            // (1 / width, 1 / height, width, height)
+
+    // SMAA preset
+    float smaaThershold;
+    float smaaDepthThreshold;
+    int smaaMaxSearchSteps;
+    int smaaMaxSearchStepsDiag;
+    int smaaCornerRounding;
+
+    // SMAA predicated edge detection
+    float predicationThreshold;
+    float predicationScale;
+    float predicationStrength;
+
+    // TAA
+    float reprojWeigthScale;
+    float taaCurrentWeight;     // 1 / jitter samples, the history converges over one cycle
+    int taaHistoryClamp;        // clamp the history to the neighborhood of the current frame
+};
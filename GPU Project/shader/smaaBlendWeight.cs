@@ -0,0 +1,61 @@
+#version 450 core
+
+// Compute version of smaaBlendWeight.fs. Dispatched indirectly with one invocation per entry
+// of the edge list written by smaaEdge.cs; blendTex is cleared before, so the pixels without
+// edges keep zero weights.
+
+#include "postprocess.glsl"
+
+#define SMAA_RT_METRICS screenSize
+#define SMAA_GLSL_4 1
+#define SMAA_DISCARD return float2(0.0, 0.0)
+
+#if !defined(SMAA_PRESET_LOW) && !defined(SMAA_PRESET_MEDIUM) && !defined(SMAA_PRESET_HIGH) && !defined(SMAA_PRESET_ULTRA)
+#define SMAA_THRESHOLD smaaThershold
+#define SMAA_DEPTH_THRESHOLD smaaDepthThreshold
+#define SMAA_MAX_SEARCH_STEPS smaaMaxSearchSteps
+#define SMAA_MAX_SEARCH_STEPS_DIAG smaaMaxSearchStepsDiag
+#define SMAA_CORNER_ROUNDING smaaCornerRounding
+#endif
+
+// as in smaaBlendWeight.fs
+#define SMAA_DISABLE_DIAG_DETECTION
+
+#include "SMAA.glsl"
+
+// must match smaaEdge.cs
+#define SMAA_WEIGHT_GROUP_SIZE 64
+
+layout (local_size_x = SMAA_WEIGHT_GROUP_SIZE) in;
+
+uniform vec4 subsampleIndices;
+
+layout (binding = 0) uniform sampler2D edgesTex;
+layout (binding = 1) uniform sampler2D areaTex;
+layout (binding = 2) uniform sampler2D searchTex;
+layout (binding = 0, rgba8) uniform writeonly image2D blendImage;
+
+layout (std430, binding = 0) readonly buffer SMAAEdgeList
+{
+    uint groupsX;
+    uint groupsY;
+    uint groupsZ;
+    uint edgeCount;
+    uint edgePixels[];  // x | y << 16
+};
+
+void main(void)
+{
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= edgeCount)
+        return;
+
+    uint packedPixel = edgePixels[index];
+    ivec2 pixel = ivec2(packedPixel & 0xFFFFu, packedPixel >> 16);
+    float2 texcoord = (float2(pixel) + 0.5) * SMAA_RT_METRICS.xy;
+
+    float2 pixcoord;
+    float4 offset[3];
+    SMAABlendingWeightCalculationVS(texcoord, pixcoord, offset);
+    imageStore(blendImage, pixel, SMAABlendingWeightCalculationPS(texcoord, pixcoord, offset, edgesTex, areaTex, searchTex, subsampleIndices));
+}
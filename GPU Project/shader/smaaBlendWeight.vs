@@ -23,11 +23,23 @@ THE SOFTWARE.
 
 #version 450 core
 
-uniform vec4 screenSize;
+#include "postprocess.glsl"
 
 #define SMAA_RT_METRICS screenSize
 
-uniform int smaaMaxSearchSteps;
+// search distance of the preset permutation, see smaaBlendWeight.fs
+#if defined(SMAA_PRESET_LOW)
+#define SMAA_MAX_SEARCH_STEPS 4
+#elif defined(SMAA_PRESET_MEDIUM)
+#define SMAA_MAX_SEARCH_STEPS 8
+#elif defined(SMAA_PRESET_HIGH)
+#define SMAA_MAX_SEARCH_STEPS 16
+#elif defined(SMAA_PRESET_ULTRA)
+#define SMAA_MAX_SEARCH_STEPS 32
+#else
+#define SMAA_MAX_SEARCH_STEPS smaaMaxSearchSteps
+#endif
+
 
 #define mad(a, b, c) fma(a, b, c)
 #define API_V_DIR(v) -(v)
@@ -43,7 +55,7 @@ void SMAABlendingWeightCalculationVS(vec2 texcoord,
 
     // And these for the searches, they indicate the ends of the loops:
     offset[2] = mad(SMAA_RT_METRICS.xxyy,
-                    vec4(-2.0, 2.0, API_V_DIR(-2.0), API_V_DIR(2.0)) * float(smaaMaxSearchSteps),
+                    vec4(-2.0, 2.0, API_V_DIR(-2.0), API_V_DIR(2.0)) * float(SMAA_MAX_SEARCH_STEPS),
                     vec4(offset[0].xz, offset[1].yw));
 }
 
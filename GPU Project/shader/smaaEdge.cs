@@ -0,0 +1,82 @@
+#version 450 core
+
+// Compute version of smaaEdge.fs. Writes the edges of every pixel and appends the pixels that
+// have an edge to the edge list, which is the input of smaaBlendWeight.cs.
+
+#include "postprocess.glsl"
+
+#define SMAA_RT_METRICS screenSize
+#define SMAA_GLSL_4 1
+#define SMAA_DISCARD return float2(0.0, 0.0)
+
+#if !defined(SMAA_PRESET_LOW) && !defined(SMAA_PRESET_MEDIUM) && !defined(SMAA_PRESET_HIGH) && !defined(SMAA_PRESET_ULTRA)
+#define SMAA_THRESHOLD smaaThershold
+#define SMAA_DEPTH_THRESHOLD smaaDepthThreshold
+#define SMAA_MAX_SEARCH_STEPS smaaMaxSearchSteps
+#define SMAA_MAX_SEARCH_STEPS_DIAG smaaMaxSearchStepsDiag
+#define SMAA_CORNER_ROUNDING smaaCornerRounding
+#endif
+
+#define SMAA_PREDICATION_THRESHOLD  predicationThreshold
+#define SMAA_PREDICATION_SCALE      predicationScale
+#define SMAA_PREDICATION_STRENGTH   predicationStrength
+
+#include "SMAA.glsl"
+
+// must match smaaBlendWeight.cs
+#define SMAA_WEIGHT_GROUP_SIZE 64u
+
+layout (local_size_x = 8, local_size_y = 8) in;
+
+layout (binding = 0) uniform sampler2D colorTex;
+layout (binding = 0, rgba8) uniform writeonly image2D edgesImage;
+
+// the indirect dispatch arguments of the blending weight pass, then the edge pixels
+layout (std430, binding = 0) buffer SMAAEdgeList
+{
+    uint groupsX;
+    uint groupsY;
+    uint groupsZ;
+    uint edgeCount;
+    uint edgePixels[];  // x | y << 16
+};
+
+// the pixels of a group are appended with a single atomic on the global list
+shared uint groupEdgeCount;
+shared uint groupFirstEdge;
+
+void main(void)
+{
+    if (gl_LocalInvocationIndex == 0u)
+        groupEdgeCount = 0u;
+    barrier();
+
+    ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+    bool inside = all(lessThan(pixel, ivec2(SMAA_RT_METRICS.zw)));
+    bool edge = false;
+    uint groupIndex = 0u;
+    if (inside)
+    {
+        float2 texcoord = (float2(pixel) + 0.5) * SMAA_RT_METRICS.xy;
+        float4 offset[3];
+        SMAAEdgeDetectionVS(texcoord, offset);
+        float2 edges = SMAAColorEdgeDetectionPS(texcoord, offset, colorTex);
+        imageStore(edgesImage, pixel, float4(edges, 0.0, 0.0));
+
+        edge = dot(edges, float2(1.0, 1.0)) > 0.0;
+        if (edge)
+            groupIndex = atomicAdd(groupEdgeCount, 1u);
+    }
+    barrier();
+
+    if (gl_LocalInvocationIndex == 0u && groupEdgeCount > 0u)
+    {
+        groupFirstEdge = atomicAdd(edgeCount, groupEdgeCount);
+        uint total = groupFirstEdge + groupEdgeCount;
+        atomicMax(groupsX, (total + SMAA_WEIGHT_GROUP_SIZE - 1u) / SMAA_WEIGHT_GROUP_SIZE);
+    }
+    barrier();
+
+    if (edge)
+        edgePixels[groupFirstEdge + groupIndex] = uint(pixel.x) | (uint(pixel.y) << 16);
+}
@@ -23,7 +23,7 @@ THE SOFTWARE.
 
 #version 450 core
 
-uniform vec4 screenSize;
+#include "postprocess.glsl"
 
 #define SMAA_RT_METRICS screenSize
 
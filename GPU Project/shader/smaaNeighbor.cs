@@ -0,0 +1,71 @@
+#version 450 core
+
+// Compute version of smaaNeighbor.fs. Each group loads its tile of color and blending weights
+// with a one pixel border into shared memory once; the weights of the right and top neighbours
+// and the two bilinear color fetches between a pixel and its neighbours are then read from there.
+
+#include "postprocess.glsl"
+
+#define SMAA_RT_METRICS screenSize
+
+#define GROUP_SIZE 16
+#define TILE_SIZE (GROUP_SIZE + 2)
+
+layout (local_size_x = GROUP_SIZE, local_size_y = GROUP_SIZE) in;
+
+layout (binding = 0) uniform sampler2D colorTex;
+layout (binding = 1) uniform sampler2D blendTex;
+layout (binding = 0, rgba8) uniform writeonly image2D outputImage;
+
+shared vec4 colors[TILE_SIZE][TILE_SIZE];
+shared vec4 weights[TILE_SIZE][TILE_SIZE];
+
+void main(void)
+{
+    ivec2 size = ivec2(SMAA_RT_METRICS.zw);
+    ivec2 tileOrigin = ivec2(gl_WorkGroupID.xy) * GROUP_SIZE - 1;
+    for (uint i = gl_LocalInvocationIndex; i < uint(TILE_SIZE * TILE_SIZE); i += uint(GROUP_SIZE * GROUP_SIZE))
+    {
+        ivec2 tile = ivec2(i % uint(TILE_SIZE), i / uint(TILE_SIZE));
+        ivec2 texel = clamp(tileOrigin + tile, ivec2(0), size - 1);
+        colors[tile.y][tile.x] = texelFetch(colorTex, texel, 0);
+        weights[tile.y][tile.x] = texelFetch(blendTex, texel, 0);
+    }
+    barrier();
+
+    ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(pixel, size)))
+        return;
+
+    // same as SMAANeighborhoodBlendingPS, with the y axis of GL (top is one row down)
+    ivec2 t = ivec2(gl_LocalInvocationID.xy) + 1;
+    vec4 a;
+    a.x = weights[t.y][t.x + 1].a;  // Right
+    a.y = weights[t.y - 1][t.x].g;  // Top
+    a.wz = weights[t.y][t.x].xz;    // Bottom / Left
+
+    vec4 color = colors[t.y][t.x];
+    if (dot(a, vec4(1.0, 1.0, 1.0, 1.0)) >= 1e-5)
+    {
+        // the blending offsets are below one pixel, so each bilinear fetch of the fragment
+        // version is a mix of this pixel and one neighbour
+        bool h = max(a.x, a.z) > max(a.y, a.w); // max(horizontal) > max(vertical)
+        vec2 blendingWeight;
+        vec4 first, second;
+        if (h)
+        {
+            blendingWeight = a.xz;
+            first = mix(color, colors[t.y][t.x + 1], a.x);
+            second = mix(color, colors[t.y][t.x - 1], a.z);
+        }
+        else
+        {
+            blendingWeight = a.yw;
+            first = mix(color, colors[t.y - 1][t.x], a.y);
+            second = mix(color, colors[t.y + 1][t.x], a.w);
+        }
+        blendingWeight /= dot(blendingWeight, vec2(1.0, 1.0));
+        color = blendingWeight.x * first + blendingWeight.y * second;
+    }
+    imageStore(outputImage, pixel, color);
+}
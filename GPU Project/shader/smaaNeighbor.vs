@@ -26,7 +26,7 @@ THE SOFTWARE.
 #define API_V_DIR(v) -(v)
 #define mad(a, b, c) fma(a, b, c)
 
-uniform vec4 screenSize;
+#include "postprocess.glsl"
 
 vec2 triangleVertex(in int vertID, out vec2 texcoord)
 {
@@ -0,0 +1,24 @@
+#version 450 core
+
+// SMAA S2x: writes the two samples of the 2x multisampled scene to separate textures, the
+// inputs of the two SMAA runs. Drawn with temporal.vs.
+
+#include "postprocess.glsl"
+
+#define SMAA_RT_METRICS screenSize
+#define SMAA_GLSL_4 1
+#define SMAA_INCLUDE_VS 0
+#define SMAA_INCLUDE_PS 1
+
+#include "SMAA.glsl"
+
+layout (binding = 0) uniform SMAATexture2DMS2(colorTexMS);
+
+layout (location = 0) in vec2 texcoord;
+layout (location = 0) out vec4 sample0;
+layout (location = 1) out vec4 sample1;
+
+void main(void)
+{
+    SMAASeparatePS(gl_FragCoord, texcoord, sample0, sample1, colorTexMS);
+}
@@ -0,0 +1,43 @@
+// TAA resolve shared by temporal.fs and fxaaTemporal.fs, include after postprocess.glsl.
+// current is the anti-aliased color of this frame at the pixel, neighbourTex the frame the
+// history is clamped to. Returns the new history color, with the velocity length in alpha
+// to be compared against next frame (as in SMAAResolvePS).
+vec4 taaResolve(vec4 current, vec2 texcoord, sampler2D neighbourTex, sampler2D previousTex, sampler2D velocityTex)
+{
+    // the velocity length is taken from the velocity buffer: the scene alpha is not written by the AA passes
+    vec2 velocity = textureLod(velocityTex, texcoord, 0.0).rg;
+    current.a = sqrt(5.0 * length(velocity));
+
+    // where this pixel was a frame ago
+    vec2 previousCoord = texcoord - velocity;
+    vec4 previous = textureLod(previousTex, previousCoord, 0.0);
+
+    // a history color outside the colors around the pixel is stale (disocclusion, shading change)
+    if (taaHistoryClamp != 0)
+    {
+        ivec2 pixel = ivec2(gl_FragCoord.xy);
+        ivec2 lastPixel = textureSize(neighbourTex, 0) - 1;
+        vec3 minColor = current.rgb;
+        vec3 maxColor = current.rgb;
+        for (int y = -1; y <= 1; y++)
+        {
+            for (int x = -1; x <= 1; x++)
+            {
+                vec3 neighbour = texelFetch(neighbourTex, clamp(pixel + ivec2(x, y), ivec2(0), lastPixel), 0).rgb;
+                minColor = min(minColor, neighbour);
+                maxColor = max(maxColor, neighbour);
+            }
+        }
+        previous.rgb = clamp(previous.rgb, minColor, maxColor);
+    }
+
+    // exponential history: the current frame gets 1 / samples, attenuated by the velocity difference
+    float delta = abs(current.a * current.a - previous.a * previous.a) / 5.0;
+    float weight = (1.0 - taaCurrentWeight) * clamp(1.0 - sqrt(delta) * reprojWeigthScale, 0.0, 1.0);
+
+    // no history for pixels that came in from outside the screen
+    if (any(notEqual(previousCoord, clamp(previousCoord, 0.0, 1.0))))
+        weight = 0.0;
+
+    return mix(current, previous, weight);
+}
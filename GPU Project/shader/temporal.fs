@@ -23,9 +23,7 @@ THE SOFTWARE.
 
 #version 450 core
 
-uniform vec4 screenSize;
-uniform float reprojWeigthScale;
-
+#include "postprocess.glsl"
 
 #define SMAA_RT_METRICS screenSize
 #define SMAA_GLSL_4 1
@@ -33,11 +31,14 @@ uniform float reprojWeigthScale;
 #define SMAA_INCLUDE_PS 1
 #define SMAA_INCLUDE_VS 0
 
+#define SMAA_REPROJECTION 1
 #define SMAA_REPROJECTION_WEIGHT_SCALE reprojWeigthScale
 
 #define LinearSampler linearSampler
 #define PointSampler  nearestSampler
 
+#include "taa.glsl"
+
 
 /**
  * Copyright (C) 2013 Jorge Jimenez (jorge@iryoku.com)
@@ -1495,6 +1496,9 @@ layout(binding = 2) uniform SMAATexture2D(previousTex);
 layout(binding = 3) uniform SMAATexture2D(velocityTex);
 #endif  // SMAA_REPROJECTION
 
+// the history of the next frame, the other one of the two history textures
+layout (rgba16f) writeonly uniform image2D historyImage;
+
 
 layout (location = 0) in vec2 texcoord;
 layout (location = 0) out vec4 outColor;
@@ -1503,8 +1507,9 @@ layout (location = 0) out vec4 outColor;
 void main(void)
 {
 #if SMAA_REPROJECTION
-	outColor = SMAAResolvePS(texcoord, currentTex, previousTex, velocityTex);
+	outColor = taaResolve(SMAASamplePoint(currentTex, texcoord), texcoord, currentTex, previousTex, velocityTex);
 #else  // SMAA_REPROJECTION
 	outColor = SMAAResolvePS(texcoord, currentTex, previousTex);
 #endif  // SMAA_REPROJECTION
+	imageStore(historyImage, ivec2(gl_FragCoord.xy), outColor);
 }
@@ -20,8 +20,25 @@
 #include <iomanip>
 #include <thread>
 #include <chrono>
+#include <cstring>
 #include <AreaTex.h>
 #include <SearchTex.h>
+#include <aa/benchmark.h>
+#include <aa/frame_stats.h>
+#include <aa/gpu_timer.h>
+#include <aa/gpu_profiler.h>
+#include <aa/gl_ext.h>
+#include <aa/msaa_targets.h>
+#include <aa/upload_ring.h>
+#include <aa/texture_loader.h>
+#include <aa/smaa_compute.h>
+#include <aa/jitter.h>
+#include <aa/smaa_modes.h>
+#include <aa/fxaa_cpu.h>
+#include <aa/smaa_cpu.h>
+#include <aa/image_metrics.h>
+#include <aa/readback_ring.h>
+#include <aa/ground_truth.h>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
@@ -31,7 +48,14 @@ void MouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
 void CursorPosCallback(GLFWwindow* window, double xpos, double ypos);
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
 void changeViewpoint(int view);
-void timeChecker(std::ofstream& outputFile, bool& benchActive);
+void applyBenchmarkConfig(GLFWwindow* window, const BenchmarkConfig& config);
+void attachMSAATarget();
+void resolveMSAATarget(bool color, bool velocity);
+int activeSMAAMode();
+int activeJitterSequence();
+int validateCPUFXAA(const char* path, int cpuPath, Shader& fxaaShader);
+int validateCPUSMAA(const char* path, int preset, Shader& edgeShader, Shader& weightShader, Shader& blendShader);
+float taaCurrentWeight();
 
 // settings
 float SCR_WIDTH = 1600.0;
@@ -57,7 +81,12 @@ double crntTime = 0.0;
 double timeDiff;
 unsigned int counter = 0;
 std::string frameDisplay;
-void timeChecker(std::ofstream& outputFile, bool& benchActive);
+std::string frameStatsDisplay;
+
+// per-frame times
+unsigned int frameNumber = 0;
+double frameStartTime = 0.0;
+double interactiveBenchmarkEnd = 0.0; // "Benchmark(10s)" button
 
 // global projection variables
 glm::mat4 globalCurrProj;
@@ -68,14 +97,16 @@ unsigned int temporalFrame = 0;
 bool temporalReproject = false;
 glm::mat4 currViewProj;
 glm::mat4 prevViewProj;
+glm::mat4 currMotionViewProj;   // unjittered view-projection of this and the last frame, for the velocity buffer
+glm::mat4 prevMotionViewProj;
 float reprojectionWeightScale = 30.0f;
 
 // jittering
 glm::vec2 jitter;
-const glm::vec2 jitters[2] = {
-    { -0.25f,  0.25f }
-    ,{ 0.25f,  -0.25f }
-};
+int taaJitterSequence = JITTER_T2X;
+int taaJitterSamples = 8;       // Halton and R2, T2x always has 2
+bool taaHistoryClamp = true;    // clamp the history to the neighborhood of the current frame
+bool fxaaTAAFused = true;       // FXAA + TAA in a single pass, fxaaTemporal.fs
 
 // detail screen
 float cursorPosX = 0.0;
@@ -86,6 +117,10 @@ static bool antiAliasing;
 static bool msaa;
 static bool fxaa;
 static bool smaa;
+static bool smaaCS;     // SMAA through the compute shader passes
+static int smaaMode = SMAA_MODE_1X;     // fragment path only, see smaa_modes.h
+static bool smaaSampleOrderSwapped;     // the 2x MSAA sample 0 is S1 of the SMAA S2x table
+static int smaaEdgeMethod = SMAA_EDGE_COLOR;    // fragment path only
 static bool taa;
 static bool wasTAAOn;
 
@@ -97,9 +132,19 @@ static bool isImage;
 
 static bool detailScreen;
 
+static int currentScene = 0;
+static int previousScene = 3;
+
+// benchmark driver
+static bool headless;
+static bool benchmarkRunning;
+BenchmarkSettings benchmarkSettings;
+unsigned int benchmarkConfigIndex = 0;
+int benchmarkFrame = 0;
+double benchmarkStartTime = 0.0;
+
 GLuint colorTex;
-GLuint multiSamplingTex;
-GLuint depthTex;
+GLuint depthTex;    // depth/stencil of colorFBO, sampled by the depth and predicated SMAA edge detection
 GLuint edgeTex;
 GLuint blendTex;
 GLuint imageTex;
@@ -109,27 +154,38 @@ GLuint areaTex;
 GLuint searchTex;
 
 GLuint currentTex;
-GLuint previousTex;
+GLuint historyTex[2];      // TAA history, RGBA16F; historyTex[historyIndex] holds the last frame
+int historyIndex = 0;
 GLuint velocityTex;
+const GLenum sceneDrawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 }; // color, velocity
 
 GLuint Subsample1;
 GLuint Subsample2;
+GLuint subsampleEdgeTex;    // edges and blending weights of the second S2x sample,
+GLuint subsampleBlendTex;   // the first one uses edgeTex and blendTex
 
 GLuint colorFBO;
 GLuint multisampledFBO;
 GLuint edgeFBO;
 GLuint blendFBO;
 GLuint detailFBO;
+GLuint separateFBO;         // Subsample1 and Subsample2, written by the S2x separate pass
+GLuint subsampleEdgeFBO;
+GLuint subsampleBlendFBO;
 
 GLuint currentFBO;
-GLuint previousFBO;
 
-GLuint colorRBO;
-GLuint multiSampledRBO;
 GLuint detailRBO;
+GLuint smaaStencilRBO; // edge pixels marked by the edge detection pass, one bit per SMAA run, shared by the SMAA FBOs
 
 GLuint quadVAO, quadVBO;
 
+// multisampled color/depth of every MSAA quality that was used, attached to multisampledFBO
+MultisampleTargetCache msaaTargets;
+
+// compute shader version of the SMAA passes, "SMAA CS" in the Control Panel
+SMAACompute smaaCompute;
+
 // highest as default
 GLuint msaaQualityLevel = 4;
 GLuint smaaPreset = 3;
@@ -165,6 +221,35 @@ SMAAParameters smaaPresets[4] =
         {0.05f, 0.1f * 0.05f, 32, 16, 25} // ultra
 };
 
+// compiled into the edge detection and blending weight programs of each preset, matching smaaPresets
+const char* smaaPresetDefines[4] =
+{
+    "#define SMAA_PRESET_LOW\n",
+    "#define SMAA_PRESET_MEDIUM\n",
+    "#define SMAA_PRESET_HIGH\n",
+    "#define SMAA_PRESET_ULTRA\n"
+};
+
+// parameter block shared by all AA passes, std140 layout of shader/postprocess.glsl
+struct PostProcessParameters
+{
+    glm::vec4 screenSize;
+    SMAAParameters smaa;
+    GLfloat predicationThreshold;
+    GLfloat predicationScale;
+    GLfloat predicationStrength;
+    GLfloat reprojWeigthScale;
+    GLfloat taaCurrentWeight;
+    GLint taaHistoryClamp;
+    GLfloat pad[1];
+};
+
+// uniform buffer bound to binding 0, rewritten only when the SMAA preset, the TAA settings or the size change
+GLuint postProcessUBO;
+GLfloat postProcessTAAWeight;  // taaCurrentWeight() when the buffer was written
+
+void updatePostProcessParameters();
+
 GLuint msaaSamples[5] = { 1, 2, 4, 8, 16 };
 
 
@@ -173,8 +258,186 @@ static void glfw_error_callback(int error, const char* description)
     fprintf(stderr, "GLFW Error %d: %s\n", error, description);
 }
 
-int main()
+int main(int argc, char** argv)
 {
+    // command line: [--headless [--osmesa]] [--config FILE] [--warmup N] [--frames N] [--out FILE]
+    //               [--fxaa-cpu IN OUT]... [--fxaa-validate IMAGE] [--fxaa-path SCALAR|SSE4|AVX2]
+    //               [--smaa-cpu IN OUT]... [--smaa-validate IMAGE] [--smaa-preset LOW|MEDIUM|HIGH|ULTRA]
+    //               [--compare IMAGE REFERENCE [--error-map OUT]] [--references]
+    // ---------------------------------------------------------------------------------
+    const char* configPath = NULL;
+    int warmupFrames = -1;
+    int frames = -1;
+    const char* outputPath = NULL;
+    std::vector<std::pair<std::string, std::string>> fxaaCpuImages;
+    const char* fxaaValidateImage = NULL;
+    int fxaaCpuPath = fxaaCpuBestPath();
+    std::vector<std::pair<std::string, std::string>> smaaCpuImages;
+    const char* smaaValidateImage = NULL;
+    int smaaCpuPreset = 3;
+    const char* compareImage = NULL;
+    const char* compareReference = NULL;
+    const char* errorMapPath = NULL;
+    bool referencesOnly = false;
+    bool osmesa = false;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--headless") == 0)
+            headless = true;
+        else if (strcmp(argv[i], "--osmesa") == 0)
+            headless = osmesa = true;
+        else if (strcmp(argv[i], "--config") == 0 && i + 1 < argc)
+            configPath = argv[++i];
+        else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc)
+            warmupFrames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            frames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+            outputPath = argv[++i];
+        else if (strcmp(argv[i], "--fxaa-cpu") == 0 && i + 2 < argc)
+        {
+            fxaaCpuImages.push_back(std::make_pair(argv[i + 1], argv[i + 2]));
+            i += 2;
+        }
+        else if (strcmp(argv[i], "--fxaa-validate") == 0 && i + 1 < argc)
+            fxaaValidateImage = argv[++i];
+        else if (strcmp(argv[i], "--fxaa-path") == 0 && i + 1 < argc)
+        {
+            fxaaCpuPath = parseFxaaCpuPath(argv[++i]);
+            if (fxaaCpuPath < 0 || !fxaaCpuPathSupported(fxaaCpuPath))
+            {
+                std::cout << "FXAA path " << argv[i] << " is not supported here" << std::endl;
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--smaa-cpu") == 0 && i + 2 < argc)
+        {
+            smaaCpuImages.push_back(std::make_pair(argv[i + 1], argv[i + 2]));
+            i += 2;
+        }
+        else if (strcmp(argv[i], "--smaa-validate") == 0 && i + 1 < argc)
+            smaaValidateImage = argv[++i];
+        else if (strcmp(argv[i], "--smaa-preset") == 0 && i + 1 < argc)
+        {
+            smaaCpuPreset = -1;
+            for (int preset = 0; preset < 4; preset++)
+                if (strcmp(argv[i + 1], benchmarkSMAANames[preset]) == 0)
+                    smaaCpuPreset = preset;
+            if (smaaCpuPreset < 0)
+            {
+                std::cout << "Unknown SMAA preset " << argv[i + 1] << std::endl;
+                return 1;
+            }
+            i++;
+        }
+        else if (strcmp(argv[i], "--compare") == 0 && i + 2 < argc)
+        {
+            compareImage = argv[i + 1];
+            compareReference = argv[i + 2];
+            i += 2;
+        }
+        else if (strcmp(argv[i], "--error-map") == 0 && i + 1 < argc)
+            errorMapPath = argv[++i];
+        else if (strcmp(argv[i], "--references") == 0)
+            referencesOnly = true;
+    }
+
+    // batch FXAA on the CPU, no window or GL needed
+    if (!fxaaCpuImages.empty())
+    {
+        for (const auto& image : fxaaCpuImages)
+        {
+            RGBAImage source, target;
+            if (!loadRGBAImage(image.first, source))
+                return 1;
+            auto start = std::chrono::high_resolution_clock::now();
+            int path = fxaaCpu(source, target, fxaaCpuPath);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+            if (!writePNG(image.second, target))
+                return 1;
+            std::cout << image.first << " -> " << image.second << ": " << source.width << "x" << source.height
+                << ", " << fxaaCpuPathNames[path] << ", " << ms << " ms" << std::endl;
+        }
+        return 0;
+    }
+
+    // batch SMAA 1x on the CPU; one SMAACpu keeps its buffers across images of the same size
+    if (!smaaCpuImages.empty())
+    {
+        SMAACpu smaa;
+        for (const auto& image : smaaCpuImages)
+        {
+            RGBAImage source, target;
+            if (!loadRGBAImage(image.first, source))
+                return 1;
+            auto start = std::chrono::high_resolution_clock::now();
+            smaa.run(source, target, smaaCpuPresets[smaaCpuPreset]);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+            if (!writePNG(image.second, target))
+                return 1;
+            std::cout << image.first << " -> " << image.second << ": " << source.width << "x" << source.height
+                << ", SMAA " << benchmarkSMAANames[smaaCpuPreset] << ", " << ms << " ms" << std::endl;
+        }
+        return 0;
+    }
+
+    // quality of an image against a reference of the same size
+    if (compareImage)
+    {
+        RGBAImage image, reference;
+        if (!loadRGBAImage(compareImage, image) || !loadRGBAImage(compareReference, reference))
+            return 1;
+        if (image.width != reference.width || image.height != reference.height)
+        {
+            std::cout << compareImage << " and " << compareReference << " differ in size" << std::endl;
+            return 1;
+        }
+        ImageMetrics metrics;
+        auto start = std::chrono::high_resolution_clock::now();
+        ImageQuality quality = metrics.compare(image, reference);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        std::cout << compareImage << " vs " << compareReference << ": PSNR " << quality.psnr << "dB, SSIM " << quality.ssim
+            << ", edge error " << quality.edgeError << " (" << ms << " ms)" << std::endl;
+        if (errorMapPath)
+        {
+            RGBAImage errorMap;
+            metrics.errorImage(errorMap);
+            if (!writePNG(errorMapPath, errorMap))
+                return 1;
+        }
+        return 0;
+    }
+
+    // the benchmark matrix comes from the config file, or is every AA configuration in the default scene
+    if (configPath)
+    {
+        if (!loadBenchmarkSettings(configPath, benchmarkSettings))
+            return 1;
+    }
+    else
+    {
+        benchmarkSettings.configs = defaultBenchmarkMatrix();
+    }
+    if (warmupFrames >= 0)
+        benchmarkSettings.warmupFrames = warmupFrames;
+    if (frames >= 0)
+        benchmarkSettings.frames = frames;
+    if (outputPath)
+        benchmarkSettings.output = outputPath;
+    if (benchmarkSettings.frames < 1)
+        benchmarkSettings.frames = 1;
+    // the ground truth is rendered in the first frame of a cell, which must not be measured
+    if (benchmarkSettings.referenceScale > 0 && benchmarkSettings.warmupFrames < 1)
+        benchmarkSettings.warmupFrames = 1;
+
+    if (referencesOnly && benchmarkSettings.referenceScale <= 0)
+    {
+        std::cout << "--references needs a reference scale above 0" << std::endl;
+        return 1;
+    }
+
+    benchmarkRunning = (headless || configPath || referencesOnly) && !benchmarkSettings.configs.empty();
+
     // glfw: initialize and configure
     // ------------------------------
     glfwSetErrorCallback(glfw_error_callback);
@@ -189,9 +452,24 @@ int main()
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 
+    // headless: hidden window, with the native context of the GPU (EGL as fallback). --osmesa
+    // asks for Mesa's software rasterizer instead, for machines without a GPU; its timings are
+    // CPU timings. GLFW still needs a display (or Xvfb) in both cases.
+    if (headless)
+    {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        if (osmesa)
+            glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+    }
+
     // glfw window creation
     // --------------------
     GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Anti Aliasing Project", NULL, NULL);
+    if (window == NULL && headless && !osmesa)
+    {
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+        window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Anti Aliasing Project", NULL, NULL);
+    }
     if (window == NULL)
     {
         std::cout << "Failed to create GLFW window" << std::endl;
@@ -254,11 +532,23 @@ int main()
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    if (!loadGLExtensions())
+        return -1;
+    // the benchmark records are only comparable on the same renderer
+    if (headless)
+        std::cout << "GL renderer: " << glGetString(GL_RENDERER) << std::endl;
 
     // configure global opengl state
     // -----------------------------
     glEnable(GL_DEPTH_TEST);
 
+    if (benchmarkRunning)
+    {
+        glfwSwapInterval(0); // never wait for vsync while benchmarking
+        std::cout << "Benchmark: " << benchmarkSettings.configs.size() << " configurations, "
+            << benchmarkSettings.warmupFrames << " warmup + " << benchmarkSettings.frames << " frames each" << std::endl;
+    }
+
     // load textures
     glEnable(GL_TEXTURE_2D);
 
@@ -271,10 +561,6 @@ int main()
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
 
-    glGenTextures(1, &multiSamplingTex);
-    glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, multiSamplingTex);
-    glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, msaaSamples[msaaQualityLevel], GL_RGB, SCR_WIDTH, SCR_HEIGHT, GL_TRUE);
-
     glGenTextures(1, &edgeTex);
     glBindTexture(GL_TEXTURE_2D, edgeTex);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -299,13 +585,25 @@ int main()
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
 
-    glGenTextures(1, &previousTex);
-    glBindTexture(GL_TEXTURE_2D, previousTex);
+    // half floats, so the small weight of the current frame is not lost to 8-bit rounding
+    glGenTextures(2, historyTex);
+    for (int i = 0; i < 2; i++)
+    {
+        glBindTexture(GL_TEXTURE_2D, historyTex[i]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
+    }
+
+    glGenTextures(1, &velocityTex);
+    glBindTexture(GL_TEXTURE_2D, velocityTex);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RG, GL_FLOAT, NULL);
 
     glGenTextures(1, &Subsample1);
     glBindTexture(GL_TEXTURE_2D, Subsample1);
@@ -323,6 +621,22 @@ int main()
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
 
+    glGenTextures(1, &subsampleEdgeTex);
+    glBindTexture(GL_TEXTURE_2D, subsampleEdgeTex);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+    glGenTextures(1, &subsampleBlendTex);
+    glBindTexture(GL_TEXTURE_2D, subsampleBlendTex);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
     glGenTextures(1, &detailTex);
     glBindTexture(GL_TEXTURE_2D, detailTex);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -395,22 +709,22 @@ int main()
     glGenFramebuffers(1, &colorFBO);
     glBindFramebuffer(GL_FRAMEBUFFER, colorFBO);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTex, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, velocityTex, 0);
 
-    glGenRenderbuffers(1, &colorRBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, colorRBO);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, SCR_WIDTH, SCR_HEIGHT);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, colorRBO);
+    // a texture rather than a renderbuffer, so SMAA can read the depth
+    glGenTextures(1, &depthTex);
+    glBindTexture(GL_TEXTURE_2D, depthTex);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, SCR_WIDTH, SCR_HEIGHT, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, NULL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depthTex, 0);
 
     // MSAA
     glGenFramebuffers(1, &multisampledFBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, multisampledFBO);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D_MULTISAMPLE, multiSamplingTex, 0);
-
-    glGenRenderbuffers(1, &multiSampledRBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, multiSampledRBO);
-    glRenderbufferStorageMultisample(GL_RENDERBUFFER, msaaSamples[msaaQualityLevel], GL_DEPTH24_STENCIL8, SCR_WIDTH, SCR_HEIGHT);
-    glBindRenderbuffer(GL_RENDERBUFFER, 0);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, multiSampledRBO);
+    attachMSAATarget();
 
     // SMAA
     glGenFramebuffers(1, &edgeFBO);
@@ -420,13 +734,33 @@ int main()
     glBindFramebuffer(GL_FRAMEBUFFER, blendFBO);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, blendTex, 0);
 
+    glGenRenderbuffers(1, &smaaStencilRBO);
+    glBindRenderbuffer(GL_RENDERBUFFER, smaaStencilRBO);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, SCR_WIDTH, SCR_HEIGHT);
+    glBindFramebuffer(GL_FRAMEBUFFER, edgeFBO);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, smaaStencilRBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, blendFBO);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, smaaStencilRBO);
+
+    // SMAA S2x
+    glGenFramebuffers(1, &separateFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, separateFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, Subsample1, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, Subsample2, 0);
+    glDrawBuffers(2, sceneDrawBuffers);
+    glGenFramebuffers(1, &subsampleEdgeFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, subsampleEdgeFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, subsampleEdgeTex, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, smaaStencilRBO);
+    glGenFramebuffers(1, &subsampleBlendFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, subsampleBlendFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, subsampleBlendTex, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, smaaStencilRBO);
+
     // TAA
     glGenFramebuffers(1, &currentFBO);
     glBindFramebuffer(GL_FRAMEBUFFER, currentFBO);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, currentTex, 0);
-    glGenFramebuffers(1, &previousFBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, previousFBO);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, previousTex, 0);
 
     // Detail
     glGenFramebuffers(1, &detailFBO);
@@ -448,18 +782,65 @@ int main()
 
     Shader fxaaShader("shader/fxaa_demo.vs", "shader/fxaa_demo.fs");
 
-    Shader smaaEdgeShader("shader/smaaEdge.vs", "shader/smaaEdge.fs");
-    Shader smaaWeightShader("shader/smaaBlendWeight.vs", "shader/smaaBlendWeight.fs");
+    // one program per SMAA preset, so the search loops have constant bounds and LOW/MEDIUM
+    // don't carry the diagonal search; the edge detection also has one per edge method
+    std::vector<Shader> smaaEdgeShaders[SMAA_EDGE_METHOD_COUNT];
+    std::vector<Shader> smaaWeightShaders;
+    for (int preset = 0; preset < 4; preset++)
+    {
+        for (int method = 0; method < SMAA_EDGE_METHOD_COUNT; method++)
+        {
+            std::string defines = std::string(smaaPresetDefines[preset]) + smaaEdgeMethodDefines[method];
+            smaaEdgeShaders[method].push_back(Shader("shader/smaaEdge.vs", "shader/smaaEdge.fs", nullptr, defines));
+        }
+        smaaWeightShaders.push_back(Shader("shader/smaaBlendWeight.vs", "shader/smaaBlendWeight.fs", nullptr, smaaPresetDefines[preset]));
+    }
     Shader smaaBlendShader("shader/smaaNeighbor.vs", "shader/smaaNeighbor.fs");
+    Shader smaaSeparateShader("shader/temporal.vs", "shader/smaaSeparate.fs");
 
     Shader taaShader("shader/temporal.vs", "shader/temporal.fs");
+    Shader fxaaTAAShader("shader/fxaa_demo.vs", "shader/fxaaTemporal.fs");
+
+    smaaCompute.init(smaaPresetDefines, 4);
+
+    // handles of the uniforms that are set every frame
+    std::vector<Uniform<glm::vec4>> smaaWeightSubsampleIndices;
+    for (Shader& shader : smaaWeightShaders)
+        smaaWeightSubsampleIndices.push_back(shader.uniform<glm::vec4>("subsampleIndices"));
+    Uniform<glm::mat4> modelProjection = modelShader.uniform<glm::mat4>("projection");
+    Uniform<glm::mat4> modelView = modelShader.uniform<glm::mat4>("view");
+    Uniform<glm::mat4> modelModel = modelShader.uniform<glm::mat4>("model");
+    Uniform<bool> modelBatched = modelShader.uniform<bool>("batched");
+    Uniform<glm::mat4> imageProjection = imageShader.uniform<glm::mat4>("projection");
+    Uniform<glm::mat4> imageView = imageShader.uniform<glm::mat4>("view");
+    Uniform<glm::mat4> imageModel = imageShader.uniform<glm::mat4>("model");
+    Uniform<glm::mat4> modelCurrViewProj = modelShader.uniform<glm::mat4>("currViewProj");
+    Uniform<glm::mat4> modelPrevViewProj = modelShader.uniform<glm::mat4>("prevViewProj");
+    Uniform<glm::mat4> imageCurrViewProj = imageShader.uniform<glm::mat4>("currViewProj");
+    Uniform<glm::mat4> imagePrevViewProj = imageShader.uniform<glm::mat4>("prevViewProj");
 
     // load models
     // -----------
+    // Sponza's textures are streamed in over the first frames instead of holding up the start
+    UploadRing uploadRing;
+    uploadRing.init(64 * 1024 * 1024);
+    TextureLoader textureStreamer;
+    textureStreamer.setUploadRing(&uploadRing);
+    const size_t textureUploadBudget = 16 * 1024 * 1024; // bytes per frame
+
     Model container("resources/objects/container/Container.obj");
-    Model sponza("resources/objects/sponza-master/sponza.obj");
+    Model sponza("resources/objects/sponza-master/sponza.obj", false, &textureStreamer);
+
+    // the benchmark measures complete scenes only
+    if (benchmarkRunning)
+        textureStreamer.finish();
 
-    Model currentModel = container;
+    // the scene pass draws a model in a few multi-draw-indirect calls once its textures are all
+    // there, Sponza's as soon as the streamer is done with them
+    container.batch.build(container.meshes);
+    bool sponzaBatched = false;
+
+    Model* currentModel = &container;
 
     modelShader.use();
     modelShader.setInt("texture_diffuse1", 0);
@@ -474,46 +855,33 @@ int main()
     // -----------
     fxaaShader.use();
     fxaaShader.setInt("colorTex", 0);
-    fxaaShader.setVec4("screenSize", glm::vec4(1.0f / SCR_WIDTH, 1.0f / SCR_HEIGHT, SCR_WIDTH, SCR_HEIGHT));
-
-    // Edge Shader
-    // -----------
-    smaaEdgeShader.use();
-    smaaEdgeShader.setInt("colorTex", 0);
-    // smaaEdgeShader.setInt("predicationTex", 0);
-
-    smaaEdgeShader.setFloat("smaaThershold", smaaPresets[smaaPreset].threshold);
-    smaaEdgeShader.setFloat("smaaDepthThreshold", smaaPresets[smaaPreset].depthThreshold);
-    smaaEdgeShader.setInt("smaaMaxSearchSteps", smaaPresets[smaaPreset].maxSearchSteps);
-    smaaEdgeShader.setInt("smaaMaxSearchStepsDiag", smaaPresets[smaaPreset].maxSearchStepsDiag);
-    smaaEdgeShader.setInt("smaaCornerRounding", smaaPresets[smaaPreset].cornerRounding);
-
-    smaaEdgeShader.setFloat("predicationThreshold", 0.01);
-    smaaEdgeShader.setFloat("predicationScale", 2.0);
-    smaaEdgeShader.setFloat("predicationStrength", 0.4);
-
-    smaaEdgeShader.setVec4("screenSize", glm::vec4(1.0f / SCR_WIDTH, 1.0f / SCR_HEIGHT, SCR_WIDTH, SCR_HEIGHT));
 
-    // Weight Shader
-    // -------------
-    smaaWeightShader.use();
-    smaaWeightShader.setInt("edgesTex", 0);
-    smaaWeightShader.setInt("areaTex", 1);
-    smaaWeightShader.setInt("searchTex", 2);
-
-    smaaWeightShader.setFloat("smaaThershold", smaaPresets[smaaPreset].threshold);
-    smaaWeightShader.setFloat("smaaDepthThreshold", smaaPresets[smaaPreset].depthThreshold);
-    smaaWeightShader.setInt("smaaMaxSearchSteps", smaaPresets[smaaPreset].maxSearchSteps);
-    smaaWeightShader.setInt("smaaMaxSearchStepsDiag", smaaPresets[smaaPreset].maxSearchStepsDiag);
-    smaaWeightShader.setInt("smaaCornerRounding", smaaPresets[smaaPreset].cornerRounding);
-
-    smaaWeightShader.setVec4("subsampleIndices", glm::vec4(1.0f, 1.0f, 1.0f, 0.0f));
+    for (int preset = 0; preset < 4; preset++)
+    {
+        // Edge Shader
+        // -----------
+        for (int method = 0; method < SMAA_EDGE_METHOD_COUNT; method++)
+        {
+            Shader& smaaEdgeShader = smaaEdgeShaders[method][preset];
+            smaaEdgeShader.use();
+            if (method == SMAA_EDGE_DEPTH)
+                smaaEdgeShader.setInt("depthTex", 0);
+            else
+                smaaEdgeShader.setInt("colorTex", 0);
+            if (method == SMAA_EDGE_PREDICATED)
+                smaaEdgeShader.setInt("predicationTex", 1);
+        }
 
-    smaaWeightShader.setFloat("predicationThreshold", 0.01);
-    smaaWeightShader.setFloat("predicationScale", 2.0);
-    smaaWeightShader.setFloat("predicationStrength", 0.4);
+        // Weight Shader
+        // -------------
+        Shader& smaaWeightShader = smaaWeightShaders[preset];
+        smaaWeightShader.use();
+        smaaWeightShader.setInt("edgesTex", 0);
+        smaaWeightShader.setInt("areaTex", 1);
+        smaaWeightShader.setInt("searchTex", 2);
 
-    smaaWeightShader.setVec4("screenSize", glm::vec4(1.0f / SCR_WIDTH, 1.0f / SCR_HEIGHT, SCR_WIDTH, SCR_HEIGHT));
+        smaaWeightShader.setVec4("subsampleIndices", glm::vec4(0.0f));
+    }
 
     // Blend Shader
     // ------------
@@ -521,25 +889,27 @@ int main()
     smaaBlendShader.setInt("colorTex", 0);
     smaaBlendShader.setInt("blendTex", 1);
 
-    smaaBlendShader.setFloat("smaaThershold", smaaPresets[smaaPreset].threshold);
-    smaaBlendShader.setFloat("smaaDepthThreshold", smaaPresets[smaaPreset].depthThreshold);
-    smaaBlendShader.setInt("smaaMaxSearchSteps", smaaPresets[smaaPreset].maxSearchSteps);
-    smaaBlendShader.setInt("smaaMaxSearchStepsDiag", smaaPresets[smaaPreset].maxSearchStepsDiag);
-    smaaBlendShader.setInt("smaaCornerRounding", smaaPresets[smaaPreset].cornerRounding);
-
-    smaaBlendShader.setFloat("predicationThreshold", 0.01);
-    smaaBlendShader.setFloat("predicationScale", 2.0);
-    smaaBlendShader.setFloat("predicationStrength", 0.4);
-
-    smaaBlendShader.setVec4("screenSize", glm::vec4(1.0f / float(SCR_WIDTH), 1.0f / float(SCR_HEIGHT), SCR_WIDTH, SCR_HEIGHT));
-
     // TAA Shader
     // ------------
     taaShader.use();
     taaShader.setInt("currentTex", 0);
     taaShader.setInt("previousTex", 1);
-
-    taaShader.setVec4("screenSize", glm::vec4(1.0f / float(SCR_WIDTH), 1.0f / float(SCR_HEIGHT), SCR_WIDTH, SCR_HEIGHT));
+    taaShader.setInt("velocityTex", 2);
+    taaShader.setInt("historyImage", 0);
+
+    fxaaTAAShader.use();
+    fxaaTAAShader.setInt("colorTex", 0);
+    fxaaTAAShader.setInt("previousTex", 1);
+    fxaaTAAShader.setInt("velocityTex", 2);
+    fxaaTAAShader.setInt("historyImage", 0);
+
+    // Post-process parameters
+    // -----------------------
+    glGenBuffers(1, &postProcessUBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, postProcessUBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(PostProcessParameters), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    updatePostProcessParameters();
 
     float quadVertices[] = { // vertex attributes for a quad that fills the entire screen in Normalized Device Coordinates.
         // positions   // texCoords
@@ -563,6 +933,20 @@ int main()
     glEnableVertexAttribArray(1);
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
 
+    if (fxaaValidateImage)
+    {
+        int result = validateCPUFXAA(fxaaValidateImage, fxaaCpuPath, fxaaShader);
+        glfwTerminate();
+        return result;
+    }
+    if (smaaValidateImage)
+    {
+        int result = validateCPUSMAA(smaaValidateImage, smaaCpuPreset, smaaEdgeShaders[SMAA_EDGE_LUMA][smaaCpuPreset],
+            smaaWeightShaders[smaaCpuPreset], smaaBlendShader);
+        glfwTerminate();
+        return result;
+    }
+
     // load txt for benchmark result
     ofstream outputFile("result.txt");
     if (!outputFile)
@@ -571,13 +955,308 @@ int main()
         return 1;
     }
 
+    // one record per benchmark cell
+    ofstream benchmarkFile;
+    ofstream benchmarkHistogramFile;
+    if (benchmarkRunning && !referencesOnly)
+    {
+        benchmarkFile.open(benchmarkSettings.output);
+        if (!benchmarkFile)
+        {
+            std::cerr << "Failed to open " << benchmarkSettings.output << std::endl;
+            return 1;
+        }
+        writeBenchmarkHeader(benchmarkFile);
+
+        benchmarkHistogramFile.open(benchmarkSettings.histogramOutput);
+        if (!benchmarkHistogramFile)
+        {
+            std::cerr << "Failed to open " << benchmarkSettings.histogramOutput << std::endl;
+            return 1;
+        }
+        writeBenchmarkHistogramHeader(benchmarkHistogramFile);
+    }
+
+    // CPU and GPU time of every frame, enough room for a whole benchmark cell
+    FrameTimeRing frameTimes(std::max(1 << 17, benchmarkSettings.frames));
+    GpuTimer frameTimer;
+    frameTimer.init();
+    GpuProfiler gpuProfiler;
+    gpuProfiler.init();
+
+    // quality score of the benchmark: every measured frame of a cell is read back through the
+    // readback ring and compared on the worker threads with the ground truth of the same view,
+    // rendered without jitter at referenceScale x referenceScale samples per pixel. The ground
+    // truth is rendered in the first warmup frame and kept while the scene, viewpoint and
+    // resolution stay; it is also cached on disk, next to the benchmark results.
+    // ------------------------------------------------------------------------
+    ReadbackRing frameReadback;
+    RGBAImage qualityReference;
+    std::string qualityReferenceKey;
+    bool qualityReferenceValid = false;     // false turns the scoring of the cell off
+    int qualityReferenceScale = 0;
+    std::mutex qualityMutex;
+    ImageQuality qualitySum;
+    int qualityFrames = 0;
+
+    auto scoreFrame = [&](unsigned int /*frame*/, const RGBAImage& image)
+    {
+        // one frame per worker at a time, so the metrics run without the pool
+        thread_local ImageMetrics metrics(NULL);
+        if (image.width != qualityReference.width || image.height != qualityReference.height)
+            return;
+        ImageQuality quality = metrics.compare(image, qualityReference);
+        std::lock_guard<std::mutex> lock(qualityMutex);
+        qualitySum.psnr += quality.psnr;
+        qualitySum.ssim += quality.ssim;
+        qualitySum.edgeError += quality.edgeError;
+        qualityFrames++;
+    };
+
+    // "Capture": the next frame as a PNG, encoded on a worker
+    bool captureRequested = false;
+    auto saveCapture = [](unsigned int frame, const RGBAImage& image)
+    {
+        std::string path = "capture_" + std::to_string(frame) + ".png";
+        if (writePNG(path, image, true))
+            std::cout << "captured " << path << std::endl;
+    };
+
+    // the scene as the frame draws it, without jitter, into the tile of the ground truth
+    auto drawGroundTruthTile = [&](const glm::mat4& tile)
+    {
+        glEnable(GL_DEPTH_TEST);
+        glClearColor(clear_color.x * clear_color.w, clear_color.y * clear_color.w, clear_color.z * clear_color.w, clear_color.w);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glm::mat4 projection = tile * glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 10000.0f);
+        glm::mat4 view = camera.GetViewMatrix();
+        if (!isImage)
+        {
+            modelShader.use();
+            modelProjection.set(projection);
+            modelView.set(view);
+            glm::mat4 model = glm::scale(glm::mat4(1.0f), glm::vec3(0.05f, 0.05f, 0.05f));
+            modelModel.set(model);
+            modelCurrViewProj.set(projection * view);
+            modelPrevViewProj.set(projection * view);
+            modelBatched.set(currentModel->batch.valid());
+            currentModel->Draw(modelShader);
+        }
+        else
+        {
+            const GLfloat white[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+            glClearBufferfv(GL_COLOR, 0, white);
+            imageShader.use();
+            imageProjection.set(projection);
+            imageView.set(view);
+            imageModel.set(glm::scale(glm::mat4(1.0f), glm::vec3(2.15f, 2.15f, 1.0f)));
+            imageCurrViewProj.set(projection * view);
+            imagePrevViewProj.set(projection * view);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, imageTex);
+            glBindVertexArray(quadVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+        }
+    };
+
+    // the ground truth of the cell's view, from the cache if it was rendered before. The cache
+    // is keyed by scene, viewpoint, resolution and scale only, delete the files after changing
+    // a scene or viewpoint.
+    auto updateQualityReference = [&](const BenchmarkConfig& config)
+    {
+        int scale = benchmarkSettings.referenceScale;
+        std::string key = std::string(benchmarkSceneNames[config.scene]) + "_" + std::to_string(config.viewpoint) + "_"
+            + std::to_string((int)SCR_WIDTH) + "x" + std::to_string((int)SCR_HEIGHT) + "_" + std::to_string(scale) + "x";
+        if (key == qualityReferenceKey)
+            return;
+
+        std::string path = "Benchmarks/reference_" + key + ".png";
+        std::ifstream cached(path, std::ios::binary);
+        bool loaded = cached && loadRGBAImage(path, qualityReference, true)
+            && qualityReference.width == (int)SCR_WIDTH && qualityReference.height == (int)SCR_HEIGHT;
+        if (!loaded)
+        {
+            double start = glfwGetTime();
+            if (!renderGroundTruth((int)SCR_WIDTH, (int)SCR_HEIGHT, scale, drawGroundTruthTile, qualityReference))
+            {
+                // nothing is cached, the next cell of the view tries again
+                std::cout << "ERROR::GROUND_TRUTH::NOT_RENDERED: " << key << ", the cell is not scored" << std::endl;
+                qualityReference = RGBAImage();
+                qualityReferenceKey.clear();
+                qualityReferenceValid = false;
+                return;
+            }
+            std::cout << "rendered " << path << " in " << glfwGetTime() - start << "s" << std::endl;
+            writePNG(path, qualityReference, true);
+        }
+        qualityReferenceKey = key;
+        qualityReferenceValid = true;
+        qualityReferenceScale = scale;
+    };
+
+    // SMAA on the fragment path, drawn to outputFBO. 1x and T2x run once on colorTex, S2x and
+    // 4x once on each sample of the 2x multisampled scene. Each pass is done for every run
+    // before the next pass starts, so that its GPU timer covers a single span. The depth based
+    // edge detection reads depthTex, for S2x the depth is resolved into it, shared by both runs.
+    // ------------------------------------------------------------------------
+    auto smaaPasses = [&](GLuint outputFBO)
+    {
+        int mode = activeSMAAMode();
+        int runCount = smaaModeSpatial(mode) ? 2 : 1;
+        const GLuint inputs[2] = { runCount == 2 ? Subsample1 : colorTex, Subsample2 };
+        const GLuint edgeFBOs[2] = { edgeFBO, subsampleEdgeFBO };
+        const GLuint edgeTextures[2] = { edgeTex, subsampleEdgeTex };
+        const GLuint blendFBOs[2] = { blendFBO, subsampleBlendFBO };
+        const GLuint blendTextures[2] = { blendTex, subsampleBlendTex };
+
+        glDisable(GL_DEPTH_TEST);
+        glBindVertexArray(quadVAO);
+
+        if (runCount == 2)
+        {
+            /* SEPARATE PASS */
+            gpuProfiler.begin(PASS_SMAA_SEPARATE);
+            glBindFramebuffer(GL_FRAMEBUFFER, separateFBO);
+            smaaSeparateShader.use();
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, msaaTargets.attachedColorTexture());
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+            glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, 0);
+
+            if (smaaEdgeMethodUsesDepth(smaaEdgeMethod))
+            {
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, multisampledFBO);
+                glBindFramebuffer(GL_DRAW_FRAMEBUFFER, colorFBO);
+                glBlitFramebuffer(0, 0, SCR_WIDTH, SCR_HEIGHT, 0, 0, SCR_WIDTH, SCR_HEIGHT, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+            }
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            gpuProfiler.end(PASS_SMAA_SEPARATE);
+        }
+
+        /* EDGE DETECTION PASS */
+        gpuProfiler.begin(PASS_SMAA_EDGE);
+        glEnable(GL_STENCIL_TEST);
+        glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+        smaaEdgeShaders[smaaEdgeMethod][smaaPreset].use();
+        if (smaaEdgeMethod == SMAA_EDGE_PREDICATED)
+        {
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, depthTex);
+        }
+        for (int run = 0; run < runCount; run++)
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, edgeFBOs[run]);
+            // clear all relevant buffers; the stencil buffer is shared, the first run clears it
+            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            glStencilMask(0xFF);
+            glClear(run == 0 ? GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT : GL_COLOR_BUFFER_BIT);
+
+            // mark the edge pixels in the stencil bit of the run, the shader discards all others
+            glStencilMask(1 << run);
+            glStencilFunc(GL_ALWAYS, 0xFF, 1 << run);
+
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, smaaEdgeMethod == SMAA_EDGE_DEPTH ? depthTex : inputs[run]);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        gpuProfiler.end(PASS_SMAA_EDGE);
+
+        /* BLENDING WEIGHT PASS */
+        gpuProfiler.begin(PASS_SMAA_WEIGHT);
+        glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+        Shader& smaaWeightShader = smaaWeightShaders[smaaPreset];
+        smaaWeightShader.use();
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, areaTex);
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, searchTex);
+        for (int run = 0; run < runCount; run++)
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, blendFBOs[run]);
+            // clear all relevant buffers; alpha too, it is the weight of the right neighbour
+            glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+
+            // weights only for the marked pixels, all others keep the cleared 0
+            glStencilFunc(GL_EQUAL, 1 << run, 1 << run);
+
+            // the area texture offsets of the sample, and of the jitter of this frame
+            int sample = smaaSampleOrderSwapped ? 1 - run : run;
+            smaaWeightSubsampleIndices[smaaPreset].set(smaaSubsampleIndices(mode, temporalFrame, runCount == 2 ? sample : 0));
+
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, edgeTextures[run]);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+        }
+        glDisable(GL_STENCIL_TEST);
+        glStencilMask(0xFF);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        gpuProfiler.end(PASS_SMAA_WEIGHT);
+
+        /* NEIGHBORHOOD BLENDING PASS */
+        gpuProfiler.begin(PASS_SMAA_BLEND);
+        glBindFramebuffer(GL_FRAMEBUFFER, outputFBO);
+        smaaBlendShader.use();
+        for (int run = 0; run < runCount; run++)
+        {
+            if (run == 1)
+            {
+                // S2x averages the two samples
+                glEnable(GL_BLEND);
+                glBlendColor(0.0f, 0.0f, 0.0f, 0.5f);
+                glBlendFunc(GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA);
+            }
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, inputs[run]);
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, blendTextures[run]);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+        }
+        glDisable(GL_BLEND);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        gpuProfiler.end(PASS_SMAA_BLEND);
+    };
+
     // render loop
     // -----------
     while (!glfwWindowShouldClose(window))
     {
+        if (textureStreamer.uploadReady(textureUploadBudget) == 0 && !sponzaBatched)
+        {
+            if (sponza.batch.build(sponza.meshes))
+                std::cout << "Sponza: " << sponza.batch.drawCount() << " draws in " << sponza.batch.groupCount() << " multi-draw calls" << std::endl;
+            sponzaBatched = true;
+        }
+
+        // one parameter block for every AA pass of the frame
+        glBindBufferBase(GL_UNIFORM_BUFFER, 0, postProcessUBO);
+
+        // benchmark: measure from the end of the warmup frames
+        if (benchmarkRunning && benchmarkFrame == benchmarkSettings.warmupFrames)
+        {
+            glFinish();
+            benchmarkStartTime = glfwGetTime();
+            frameTimes.reset(frameNumber);
+            gpuProfiler.reset(frameNumber);
+        }
+
         // frame counter implementation
         // -----------------------------
         crntTime = glfwGetTime();
+
+        // the CPU time of a frame is known once the next one starts, the GPU time a few frames later
+        if (frameNumber > 0)
+            frameTimes.setCpu(frameNumber - 1, (crntTime - frameStartTime) * 1000.0);
+        frameTimes.beginFrame(frameNumber);
+        frameStartTime = crntTime;
+
+        unsigned int timedFrame;
+        double gpuMs;
+        while (frameTimer.read(timedFrame, gpuMs))
+            frameTimes.setGpu(timedFrame, gpuMs);
+        gpuProfiler.beginFrame(frameNumber);
+
         timeDiff = crntTime - prevTime;
         counter++;
 
@@ -591,7 +1270,12 @@ int main()
             msStream << std::fixed << std::setprecision(1) << ms;
             frameDisplay = fpsStream.str() + "FPS/ " + msStream.str() + "ms";
 
-            outputFile << fpsStream.str() + "\n";
+            // stutter over the last second or so
+            FrameStats cpuStats = frameTimes.cpuStats(1000);
+            FrameStats gpuStats = frameTimes.gpuStats(1000);
+            std::stringstream statsStream;
+            statsStream << std::fixed << std::setprecision(2) << "p99 " << cpuStats.p99 << "ms/ GPU " << gpuStats.median << "ms";
+            frameStatsDisplay = statsStream.str();
 
             prevTime = crntTime;
             counter = 0;
@@ -602,16 +1286,28 @@ int main()
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
-        // Start the Dear ImGui frame
-        ImGui_ImplOpenGL3_NewFrame();
-        ImGui_ImplGlfw_NewFrame();
-        ImGui::NewFrame();
+        if (!headless)
+        {
+            // Start the Dear ImGui frame
+            ImGui_ImplOpenGL3_NewFrame();
+            ImGui_ImplGlfw_NewFrame();
+            ImGui::NewFrame();
+
+            // input
+            // -----
+            if (!benchmarkRunning)
+                processInput(window);
+        }
 
-        // input
-        // -----
-        processInput(window);
+        // benchmark: switch to the next cell of the matrix
+        if (benchmarkRunning && benchmarkFrame == 0)
+        {
+            applyBenchmarkConfig(window, benchmarkSettings.configs[benchmarkConfigIndex]);
+            outputFile << "AA Method : " << benchmarkConfigName(benchmarkSettings.configs[benchmarkConfigIndex]) << std::endl;
+        }
 
         /* ----- Render Control Panel GUI ----- */
+        if (!headless)
         {
             // Set window size before create it
             ImGui::SetNextWindowSize(ImVec2(200, 550), 0);
@@ -620,6 +1316,7 @@ int main()
             ImGui::SeparatorText("Frame Counter");
 
             ImGui::TextColored(ImVec4(1, 1, 0, 1), frameDisplay.c_str());
+            ImGui::TextColored(ImVec4(1, 1, 0, 1), frameStatsDisplay.c_str());
 
             ImGui::SeparatorText("Anti Aliasing");
             if (ImGui::Checkbox("AA On", &antiAliasing))
@@ -635,6 +1332,11 @@ int main()
                     break;
                 case 2:
                     smaa = true;
+                    smaaCS = false;
+                    break;
+                case 3:
+                    smaa = true;
+                    smaaCS = true;
                     break;
                 }
                 if (wasTAAOn) {
@@ -662,9 +1364,17 @@ int main()
                 ImGui::TableNextColumn();
                 if (ImGui::RadioButton("SMAA", &currentAA, 2)) {
                     smaa = true;
+                    smaaCS = false;
                     fxaa = msaa = false;
                     outputFile << "AA Method : SMAA " << std::endl;
                 }
+                ImGui::TableNextColumn();
+                if (ImGui::RadioButton("SMAA CS", &currentAA, 3)) {
+                    smaa = true;
+                    smaaCS = true;
+                    fxaa = msaa = false;
+                    outputFile << "AA Method : SMAA CS " << std::endl;
+                }
 
                 ImGui::EndTable();
             }
@@ -690,6 +1400,21 @@ int main()
                 }
             }
 
+            const char* jitterSequences[] = { "T2x", "Halton(2,3)", "R2" };
+            bool taaSettingsChanged = ImGui::Combo("Jitter", &taaJitterSequence, jitterSequences, IM_ARRAYSIZE(jitterSequences));
+            if (taaJitterSequence != JITTER_T2X)
+                taaSettingsChanged |= ImGui::SliderInt("Samples", &taaJitterSamples, JITTER_MIN_SAMPLES, JITTER_MAX_SAMPLES);
+            taaSettingsChanged |= ImGui::Checkbox("History clamp", &taaHistoryClamp);
+            if (ImGui::Checkbox("Fuse with FXAA", &fxaaTAAFused))
+                outputFile << "FXAA + TAA : " << (fxaaTAAFused ? "fused" : "separate passes") << std::endl;
+            if (taaSettingsChanged)
+            {
+                updatePostProcessParameters();
+                outputFile << "TAA Jitter : " << jitterSequenceNames[taaJitterSequence] << " "
+                    << jitterSampleCount(taaJitterSequence, taaJitterSamples) << " samples, history clamp "
+                    << (taaHistoryClamp ? "on" : "off") << std::endl;
+            }
+
             // Bind to 'AA on' button
             if (antiAliasing == false)
             {
@@ -706,76 +1431,35 @@ int main()
             ImGui::SeparatorText("MSAA Quality");
             ImGui::Combo("##MSAA Quality", &currentMSAAQuality, msaaQualities, IM_ARRAYSIZE(msaaQualities));
 
-            if (currentMSAAQuality != previousMSAAQuailty)
-            {
-                switch (currentMSAAQuality)
-                {
-                case 0:
-                    msaaQualityLevel = 0;
-                    outputFile << "MSAA 1X " << std::endl;
-                    break;
-                case 1:
-                    msaaQualityLevel = 1;
-                    outputFile << "MSAA 2X " << std::endl;
-                    break;
-                case 2:
-                    msaaQualityLevel = 2;
-                    outputFile << "MSAA 4X " << std::endl;
-                    break;
-                case 3:
-                    msaaQualityLevel = 3;
-                    outputFile << "MSAA 8X " << std::endl;
-                    break;
-                case 4:
-                    msaaQualityLevel = 4;
-                    outputFile << "MSAA 16X " << std::endl;
-                    break;
-                }
-                previousMSAAQuailty = currentMSAAQuality;
-            }
-
-            // Change the actual number of samples
-            if (msaa)
-            {
-                glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, multiSamplingTex);
-                glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, msaaSamples[msaaQualityLevel], GL_RGB, SCR_WIDTH, SCR_HEIGHT, GL_TRUE);
-                glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, 0);
-
-                glBindRenderbuffer(GL_RENDERBUFFER, multiSampledRBO);
-                glRenderbufferStorageMultisample(GL_RENDERBUFFER, msaaSamples[msaaQualityLevel], GL_DEPTH24_STENCIL8, SCR_WIDTH, SCR_HEIGHT);
-                glBindRenderbuffer(GL_RENDERBUFFER, 0);
-            }
-
             /* ----- SMAA Quality ----- */
             const char* smaaQualities[] = { "LOW", "MEDIUM", "HIGH", "ULTRA" };
 
             ImGui::SeparatorText("SMAA Quality");
             ImGui::Combo("##SMAA Quality", &currentSMAAQuality, smaaQualities, IM_ARRAYSIZE(smaaQualities));
 
-            if (currentSMAAQuality != previousSMAAQuality)
+            /* ----- SMAA Mode (not for SMAA CS) ----- */
+            const char* smaaModes[] = { "1x", "T2x", "S2x", "4x" };
+
+            ImGui::SeparatorText("SMAA Mode");
+            if (ImGui::Combo("##SMAA Mode", &smaaMode, smaaModes, IM_ARRAYSIZE(smaaModes)))
             {
-                switch (currentSMAAQuality)
+                // T2x and 4x are resolved with the last frame by the TAA pass
+                if (smaaModeTemporal(smaaMode) && antiAliasing)
                 {
-                case 0:
-                    smaaPreset = 0;
-                    outputFile << "SMAA LOW " << std::endl;
-                    break;
-                case 1:
-                    smaaPreset = 1;
-                    outputFile << "SMAA MEDIUM " << std::endl;
-                    break;
-                case 2:
-                    smaaPreset = 2;
-                    outputFile << "SMAA HIGH " << std::endl;
-                    break;
-                case 3:
-                    smaaPreset = 3;
-                    outputFile << "SMAA ULTRA " << std::endl;
-                    break;
+                    taa = true;
+                    wasTAAOn = true;
                 }
-                previousSMAAQuality = currentSMAAQuality;
+                outputFile << "SMAA Mode : " << smaaModeNames[smaaMode] << std::endl;
             }
 
+            /* ----- SMAA Edge Detection (not for SMAA CS) ----- */
+            const char* smaaEdgeMethods[] = { "Luma", "Color", "Depth", "Predicated (luma + depth)" };
+
+            ImGui::SeparatorText("SMAA Edge Detection");
+            if (ImGui::Combo("##SMAA Edge Detection", &smaaEdgeMethod, smaaEdgeMethods, IM_ARRAYSIZE(smaaEdgeMethods)))
+                outputFile << "SMAA Edge Detection : " << smaaEdgeMethodNames[smaaEdgeMethod] << std::endl;
+
+
             /* ----- Change Viewpoint ----- */
             ImGui::SeparatorText("Viewpoint");
             if (ImGui::Button("1"))
@@ -789,51 +1473,34 @@ int main()
 
             /*----- Change Scene -----*/
             const char* scenes[] = { "Container", "Sponza", "Image" };
-            static int currentScene = 0;
-            static int previousScene = 3;
             ImGui::SeparatorText("Scene");
             ImGui::Combo("Scene", &currentScene, scenes, IM_ARRAYSIZE(scenes));
 
-            if (currentScene != previousScene)
-            {
-                switch (currentScene)
-                {
-                case 0:
-                    isImage = false;
-                    changeViewpoint(1);
-                    currentModel = container;
-                    outputFile << "Current Scene : Container " << std::endl;
-                    break;
-                case 1:
-                    isImage = false;
-                    changeViewpoint(1);
-                    currentModel = sponza;
-                    outputFile << "Current Scene : Sponza " << std::endl;
-                    break;
-                case 2:
-                    isImage = true;
-                    camera.Position = glm::vec3(-0.122459f, 0.039916f, 5.372975f);
-                    camera.Yaw = -89.200050f;
-                    camera.Pitch = -0.900008;
-                    camera.ProcessMouseMovement(0, 0);
-                    outputFile << "Current Scene : Image " << std::endl;
-                    break;
-                }
-                previousScene = currentScene;
-            }
-
             ImGui::SeparatorText("Detail Screen");
             ImGui::Checkbox("Show", &detailScreen);
 
+            /*----- GPU time of every pass -----*/
+            ImGui::SeparatorText("GPU Passes");
+            for (int pass = 0; pass < GPU_PASS_COUNT; pass++)
+            {
+                double passMs;
+                if (gpuProfiler.recent((GpuPass)pass, passMs))
+                    ImGui::Text("%-13s %.3fms", gpuPassNames[pass], passMs);
+            }
+
             /*----- Benchmarking -----*/
-            bool benchActive = false;
             ImGui::NewLine();
             if (ImGui::Button("Benchmark(10s)"))
             {
-                benchActive = true;
-                std::thread timeCheckerThread(timeChecker, std::ref(outputFile), std::ref(benchActive));
-                timeCheckerThread.detach();
+                // record every frame from the next one on
+                interactiveBenchmarkEnd = glfwGetTime() + 10.0;
+                frameTimes.reset(frameNumber + 1);
+                gpuProfiler.reset(frameNumber + 1);
+                outputFile << "start benchmarking" << std::endl;
             }
+            ImGui::SameLine();
+            if (ImGui::Button("Capture"))
+                captureRequested = true;
 
             ImGui::NewLine();
             if (ImGui::Button("Exit"))
@@ -842,9 +1509,118 @@ int main()
             ImGui::End();
         }
 
+        /* ----- Apply settings chosen in the Control Panel (or by the benchmark) ----- */
+        if (currentMSAAQuality != previousMSAAQuailty)
+        {
+            switch (currentMSAAQuality)
+            {
+            case 0:
+                msaaQualityLevel = 0;
+                outputFile << "MSAA 1X " << std::endl;
+                break;
+            case 1:
+                msaaQualityLevel = 1;
+                outputFile << "MSAA 2X " << std::endl;
+                break;
+            case 2:
+                msaaQualityLevel = 2;
+                outputFile << "MSAA 4X " << std::endl;
+                break;
+            case 3:
+                msaaQualityLevel = 3;
+                outputFile << "MSAA 8X " << std::endl;
+                break;
+            case 4:
+                msaaQualityLevel = 4;
+                outputFile << "MSAA 16X " << std::endl;
+                break;
+            }
+            previousMSAAQuailty = currentMSAAQuality;
+
+            // Change the actual number of samples
+            attachMSAATarget();
+        }
+
+        if (currentSMAAQuality != previousSMAAQuality)
+        {
+            switch (currentSMAAQuality)
+            {
+            case 0:
+                smaaPreset = 0;
+                outputFile << "SMAA LOW " << std::endl;
+                break;
+            case 1:
+                smaaPreset = 1;
+                outputFile << "SMAA MEDIUM " << std::endl;
+                break;
+            case 2:
+                smaaPreset = 2;
+                outputFile << "SMAA HIGH " << std::endl;
+                break;
+            case 3:
+                smaaPreset = 3;
+                outputFile << "SMAA ULTRA " << std::endl;
+                break;
+            }
+            previousSMAAQuality = currentSMAAQuality;
+
+            updatePostProcessParameters();
+        }
+
+        // S2x and 4x render the scene with 2x MSAA; as long as the attached target fits, this
+        // only compares it with the settings, without looking in the cache
+        bool smaaSpatial = smaaModeSpatial(activeSMAAMode());
+        if (msaa || smaaSpatial)
+            attachMSAATarget();
+
+        // the SMAA mode can replace the jitter of TAA, and with it the weight of the history
+        if (taaCurrentWeight() != postProcessTAAWeight)
+            updatePostProcessParameters();
+
+        if (currentScene != previousScene)
+        {
+            switch (currentScene)
+            {
+            case 0:
+                isImage = false;
+                changeViewpoint(1);
+                currentModel = &container;
+                outputFile << "Current Scene : Container " << std::endl;
+                break;
+            case 1:
+                isImage = false;
+                changeViewpoint(1);
+                currentModel = &sponza;
+                outputFile << "Current Scene : Sponza " << std::endl;
+                break;
+            case 2:
+                isImage = true;
+                camera.Position = glm::vec3(-0.122459f, 0.039916f, 5.372975f);
+                camera.Yaw = -89.200050f;
+                camera.Pitch = -0.900008;
+                camera.ProcessMouseMovement(0, 0);
+                outputFile << "Current Scene : Image " << std::endl;
+                break;
+            }
+            previousScene = currentScene;
+        }
+
+        // the scene switch above resets the camera, so the benchmark viewpoint goes last
+        if (benchmarkRunning && benchmarkFrame == 0)
+            changeViewpoint(benchmarkSettings.configs[benchmarkConfigIndex].viewpoint);
+
+        // benchmark: the ground truth of the cell, in its first frame (always a warmup frame)
+        // before anything is rendered or read back. No worker reads it here, the last cell's
+        // frames were all scored before its record was written.
+        if (benchmarkRunning && benchmarkSettings.referenceScale > 0 && benchmarkFrame == 0)
+            updateQualityReference(benchmarkSettings.configs[benchmarkConfigIndex]);
+
+        frameTimer.begin(frameNumber);
+        gpuProfiler.begin(PASS_SCENE);
+
         if (antiAliasing)
         {
-            if (msaa)
+            if (msaa || smaaSpatial)
             {
                 glBindFramebuffer(GL_FRAMEBUFFER, multisampledFBO);
             }
@@ -852,6 +1628,8 @@ int main()
             {
                 glBindFramebuffer(GL_FRAMEBUFFER, colorFBO);
             }
+            // the motion vectors go to the second attachment, only TAA reads them
+            glDrawBuffers(wasTAAOn ? 2 : 1, sceneDrawBuffers);
         }
         else
         {
@@ -862,6 +1640,11 @@ int main()
 
         glClearColor(clear_color.x * clear_color.w, clear_color.y * clear_color.w, clear_color.z * clear_color.w, clear_color.w);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        if (antiAliasing && wasTAAOn)
+        {
+            const GLfloat noMotion[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            glClearBufferfv(GL_COLOR, 1, noMotion);
+        }
 
         // view/projection transformations
         glm::mat4 model;
@@ -871,6 +1654,12 @@ int main()
 
         glm::mat4 viewProj = projection * view * model;
 
+        // the motion vectors leave out the jitter; a new history starts without motion
+        prevMotionViewProj = currMotionViewProj;
+        currMotionViewProj = projection * view;
+        if (temporalAAFirstFrame)
+            prevMotionViewProj = currMotionViewProj;
+
         if (!isImage)
         {
             allowMouseInput = true;
@@ -878,20 +1667,20 @@ int main()
 
             if (!taa)
             {
-                modelShader.setMat4("projection", projection);
-                modelShader.setMat4("view", view);
+                modelProjection.set(projection);
+                modelView.set(view);
             }
             else
             {
-                temporalFrame = (temporalFrame + 1) % 2;
+                temporalFrame = (temporalFrame + 1) % jitterSampleCount(activeJitterSequence(), taaJitterSamples);
 
-                jitter = jitters[temporalFrame];
+                jitter = jitterOffset(activeJitterSequence(), taaJitterSamples, temporalFrame);
                 jitter = jitter * 2.0f * glm::vec2(1.0f / SCR_WIDTH, 1.0f / SCR_HEIGHT);
                 glm::mat4 jitterMatrix = glm::translate(glm::identity<glm::mat4>(), glm::vec3(jitter, 0.0f));
                 projection = jitterMatrix * projection;
 
-                modelShader.setMat4("projection", globalCurrProj);
-                modelShader.setMat4("view", view);
+                modelProjection.set(projection);
+                modelView.set(view);
 
                 prevViewProj = currViewProj;
                 currViewProj = projection;
@@ -902,8 +1691,11 @@ int main()
             glm::mat4 model = glm::mat4(1.0f);
             model = glm::translate(model, glm::vec3(0.0f, 0.0f, 0.0f)); // translate it down so it's at the center of the scene
             model = glm::scale(model, glm::vec3(0.05f, 0.05f, 0.05f));  // it's a bit too big for our scene, so scale it down
-            modelShader.setMat4("model", model);
-            currentModel.Draw(modelShader);
+            modelModel.set(model);
+            modelCurrViewProj.set(currMotionViewProj);
+            modelPrevViewProj.set(prevMotionViewProj);
+            modelBatched.set(currentModel->batch.valid());
+            currentModel->Draw(modelShader);
         }
         else
         {
@@ -912,20 +1704,20 @@ int main()
 
             if (!taa)
             {
-                imageShader.setMat4("projection", projection);
-                imageShader.setMat4("view", view);
+                imageProjection.set(projection);
+                imageView.set(view);
             }
             else
             {
-                temporalFrame = (temporalFrame + 1) % 2;
+                temporalFrame = (temporalFrame + 1) % jitterSampleCount(activeJitterSequence(), taaJitterSamples);
 
-                jitter = jitters[temporalFrame];
+                jitter = jitterOffset(activeJitterSequence(), taaJitterSamples, temporalFrame);
                 jitter = jitter * 2.0f * glm::vec2(1.0f / SCR_WIDTH, 1.0f / SCR_HEIGHT);
                 glm::mat4 jitterMatrix = glm::translate(glm::identity<glm::mat4>(), glm::vec3(jitter, 0.0f));
                 projection = jitterMatrix * projection;
 
-                imageShader.setMat4("projection", globalCurrProj);
-                imageShader.setMat4("view", view);
+                imageProjection.set(projection);
+                imageView.set(view);
 
                 prevViewProj = currViewProj;
                 currViewProj = projection;
@@ -934,8 +1726,9 @@ int main()
 
             }
 
-            glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
-            glClear(GL_COLOR_BUFFER_BIT);
+            // white background, the velocity attachment keeps its cleared 0
+            const GLfloat white[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+            glClearBufferfv(GL_COLOR, 0, white);
             // render the loaded model
             glm::mat4 model = glm::mat4(1.0f);
             model = glm::translate(model, glm::vec3(0.0f, 0.0f, 0.0f)); // translate it down so it's at the center of the scene
@@ -945,7 +1738,9 @@ int main()
             // glm::mat4 projection = glm::ortho(0, width, height, 0, 0, 1000);
 
             // modelShader.setMat4("projection", projection);
-            imageShader.setMat4("model", model);
+            imageModel.set(model);
+            imageCurrViewProj.set(currMotionViewProj);
+            imagePrevViewProj.set(prevMotionViewProj);
 
             glActiveTexture(GL_TEXTURE0);
             glBindTexture(GL_TEXTURE_2D, imageTex);
@@ -955,8 +1750,11 @@ int main()
         }
 
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        gpuProfiler.end(PASS_SCENE);
 
         if (antiAliasing && wasTAAOn) {
+            // FXAA writes to the TAA resolve directly, without currentTex in between
+            bool fusedFXAATAA = fxaa && fxaaTAAFused;
 
             glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
@@ -966,10 +1764,9 @@ int main()
             glClear(GL_COLOR_BUFFER_BIT);
 
             if (msaa) {
+                gpuProfiler.begin(PASS_MSAA_RESOLVE);
 
-                glBindFramebuffer(GL_READ_FRAMEBUFFER, multisampledFBO);
-                glBindFramebuffer(GL_DRAW_FRAMEBUFFER, colorFBO);
-                glBlitFramebuffer(0, 0, SCR_WIDTH, SCR_HEIGHT, 0, 0, SCR_WIDTH, SCR_HEIGHT, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+                resolveMSAATarget(true, wasTAAOn && msaaTargets.attachedHasVelocity());
 
                 glBindFramebuffer(GL_FRAMEBUFFER, currentFBO);
                 glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
@@ -983,8 +1780,16 @@ int main()
                 glDrawArrays(GL_TRIANGLES, 0, 6);
 
                 glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                gpuProfiler.end(PASS_MSAA_RESOLVE);
             }
-            if (fxaa) {
+            if (smaaSpatial && wasTAAOn && msaaTargets.attachedHasVelocity()) {
+                // S2x takes the color samples apart itself, only the motion vectors are resolved
+                gpuProfiler.begin(PASS_MSAA_RESOLVE);
+                resolveMSAATarget(false, true);
+                gpuProfiler.end(PASS_MSAA_RESOLVE);
+            }
+            if (fxaa && !fusedFXAATAA) {
+                gpuProfiler.begin(PASS_FXAA);
 
                 glBindFramebuffer(GL_FRAMEBUFFER, currentFBO);
                 glDisable(GL_DEPTH_TEST); // disable depth test so screen-space quad isn't discarded due to depth test.
@@ -993,7 +1798,6 @@ int main()
                 glClear(GL_COLOR_BUFFER_BIT);
 
                 fxaaShader.use();
-                fxaaShader.setVec4("screenSize", glm::vec4(1.0f / SCR_WIDTH, 1.0f / SCR_HEIGHT, SCR_WIDTH, SCR_HEIGHT));
 
                 glBindVertexArray(quadVAO);
                 glActiveTexture(GL_TEXTURE0);
@@ -1001,119 +1805,78 @@ int main()
                 glDrawArrays(GL_TRIANGLES, 0, 6);
 
                 glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                gpuProfiler.end(PASS_FXAA);
             }
-            if (smaa) {
-
-                /* EDGE DETECTION PASS */
-                glBindFramebuffer(GL_FRAMEBUFFER, edgeFBO);
-                glDisable(GL_DEPTH_TEST);
-                // clear all relevant buffers
-                glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-                glClear(GL_COLOR_BUFFER_BIT);
-
-                smaaEdgeShader.use();
-                // set SMAA quality
-                smaaEdgeShader.setFloat("smaaThershold", smaaPresets[smaaPreset].threshold);
-                smaaEdgeShader.setFloat("smaaDepthThreshold", smaaPresets[smaaPreset].depthThreshold);
-                smaaEdgeShader.setInt("smaaMaxSearchSteps", smaaPresets[smaaPreset].maxSearchSteps);
-                smaaEdgeShader.setInt("smaaMaxSearchStepsDiag", smaaPresets[smaaPreset].maxSearchStepsDiag);
-                smaaEdgeShader.setInt("smaaCornerRounding", smaaPresets[smaaPreset].cornerRounding);
-                smaaEdgeShader.setVec4("screenSize", glm::vec4(1.0f / SCR_WIDTH, 1.0f / SCR_HEIGHT, SCR_WIDTH, SCR_HEIGHT));
-
-                glBindVertexArray(quadVAO);
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, colorTex); // use the color attachment texture as the texture of the quad plane
-                glDrawArrays(GL_TRIANGLES, 0, 6);
-
-                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            if (smaa && !smaaCS) {
+                smaaPasses(currentFBO);
+            }
+            if (smaa && smaaCS) {
+                gpuProfiler.begin(PASS_SMAA_EDGE);
+                smaaCompute.detectEdges(smaaPreset, colorTex, edgeTex, SCR_WIDTH, SCR_HEIGHT);
+                gpuProfiler.end(PASS_SMAA_EDGE);
 
-                /* BLENDING WEIGHT PASS */
+                gpuProfiler.begin(PASS_SMAA_WEIGHT);
                 glBindFramebuffer(GL_FRAMEBUFFER, blendFBO);
-
-                // clear all relevant buffers
-                glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+                glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
                 glClear(GL_COLOR_BUFFER_BIT);
-
-                smaaWeightShader.use();
-                // set SMAA quality
-                smaaWeightShader.setFloat("smaaThershold", smaaPresets[smaaPreset].threshold);
-                smaaWeightShader.setFloat("smaaDepthThreshold", smaaPresets[smaaPreset].depthThreshold);
-                smaaWeightShader.setInt("smaaMaxSearchSteps", smaaPresets[smaaPreset].maxSearchSteps);
-                smaaWeightShader.setInt("smaaMaxSearchStepsDiag", smaaPresets[smaaPreset].maxSearchStepsDiag);
-                smaaWeightShader.setInt("smaaCornerRounding", smaaPresets[smaaPreset].cornerRounding);
-                smaaWeightShader.setVec4("screenSize", glm::vec4(1.0f / SCR_WIDTH, 1.0f / SCR_HEIGHT, SCR_WIDTH, SCR_HEIGHT));
-
-                glBindVertexArray(quadVAO);
-
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, edgeTex);
-                glActiveTexture(GL_TEXTURE1);
-                glBindTexture(GL_TEXTURE_2D, areaTex);
-                glActiveTexture(GL_TEXTURE2);
-                glBindTexture(GL_TEXTURE_2D, searchTex);
-
-                glDrawArrays(GL_TRIANGLES, 0, 6);
                 glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                smaaCompute.computeWeights(smaaPreset, edgeTex, areaTex, searchTex, blendTex);
+                gpuProfiler.end(PASS_SMAA_WEIGHT);
 
-                glBindFramebuffer(GL_FRAMEBUFFER, currentFBO);
+                gpuProfiler.begin(PASS_SMAA_BLEND);
+                smaaCompute.blend(colorTex, blendTex, currentTex, SCR_WIDTH, SCR_HEIGHT);
+                gpuProfiler.end(PASS_SMAA_BLEND);
+            }
 
-                /*
-                /* NEIGHBORHOOD BLENDING PASS */
-                smaaBlendShader.use();
-                // set SMAA quality
-                smaaBlendShader.setFloat("smaaThershold", smaaPresets[smaaPreset].threshold);
-                smaaBlendShader.setFloat("smaaDepthThreshold", smaaPresets[smaaPreset].depthThreshold);
-                smaaBlendShader.setInt("smaaMaxSearchSteps", smaaPresets[smaaPreset].maxSearchSteps);
-                smaaBlendShader.setInt("smaaMaxSearchStepsDiag", smaaPresets[smaaPreset].maxSearchStepsDiag);
-                smaaBlendShader.setInt("smaaCornerRounding", smaaPresets[smaaPreset].cornerRounding);
-                smaaBlendShader.setVec4("screenSize", glm::vec4(1.0f / SCR_WIDTH, 1.0f / SCR_HEIGHT, SCR_WIDTH, SCR_HEIGHT));
+            // the resolve reads the history of the last frame and stores its result in the other
+            // history texture while it draws to the screen, so the history needs no copy
+            GLuint previousTex = historyTex[historyIndex];
+            glBindImageTexture(0, historyTex[1 - historyIndex], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
 
-                glBindVertexArray(quadVAO);
+            if (fusedFXAATAA) {
+                gpuProfiler.begin(PASS_FXAA_TAA);
+                fxaaTAAShader.use();
 
+                glBindVertexArray(quadVAO);
                 glActiveTexture(GL_TEXTURE0);
                 glBindTexture(GL_TEXTURE_2D, colorTex);
                 glActiveTexture(GL_TEXTURE1);
-                glBindTexture(GL_TEXTURE_2D, blendTex);
+                glBindTexture(GL_TEXTURE_2D, temporalAAFirstFrame ? colorTex : previousTex);
+                glActiveTexture(GL_TEXTURE2);
+                glBindTexture(GL_TEXTURE_2D, velocityTex);
 
                 glDrawArrays(GL_TRIANGLES, 0, 6);
-
-                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                gpuProfiler.end(PASS_FXAA_TAA);
             }
+            else {
+                gpuProfiler.begin(PASS_TAA_RESOLVE);
+                taaShader.use();
 
-            taaShader.use();
-
-            glBindVertexArray(quadVAO);
-
-            if (temporalAAFirstFrame) {
+                glBindVertexArray(quadVAO);
                 glActiveTexture(GL_TEXTURE0);
                 glBindTexture(GL_TEXTURE_2D, currentTex);
                 glActiveTexture(GL_TEXTURE1);
-                glBindTexture(GL_TEXTURE_2D, currentTex);
+                glBindTexture(GL_TEXTURE_2D, temporalAAFirstFrame ? currentTex : previousTex);
+                glActiveTexture(GL_TEXTURE2);
+                glBindTexture(GL_TEXTURE_2D, velocityTex);
 
-                temporalAAFirstFrame = false;
-            }
-            else {
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, currentTex);
-                glActiveTexture(GL_TEXTURE1);
-                glBindTexture(GL_TEXTURE_2D, previousTex);
+                glDrawArrays(GL_TRIANGLES, 0, 6);
+                gpuProfiler.end(PASS_TAA_RESOLVE);
             }
 
-            glDrawArrays(GL_TRIANGLES, 0, 6);
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previousFBO);
-            glBlitFramebuffer(0, 0, SCR_WIDTH, SCR_HEIGHT, 0, 0, SCR_WIDTH, SCR_HEIGHT, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+            // the image stores are read through a sampler next frame
+            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+            historyIndex = 1 - historyIndex;
+            temporalAAFirstFrame = false;
 
             glBindFramebuffer(GL_FRAMEBUFFER, 0);
         }
         else {
             // TAA off
             if (msaa) {
+                gpuProfiler.begin(PASS_MSAA_RESOLVE);
 
-                glBindFramebuffer(GL_READ_FRAMEBUFFER, multisampledFBO);
-                glBindFramebuffer(GL_DRAW_FRAMEBUFFER, colorFBO);
-                glBlitFramebuffer(0, 0, SCR_WIDTH, SCR_HEIGHT, 0, 0, SCR_WIDTH, SCR_HEIGHT, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+                resolveMSAATarget(true, false);
 
                 glBindFramebuffer(GL_FRAMEBUFFER, 0);
                 glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
@@ -1127,8 +1890,10 @@ int main()
                 glDrawArrays(GL_TRIANGLES, 0, 6);
 
                 glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                gpuProfiler.end(PASS_MSAA_RESOLVE);
             }
             if (fxaa) {
+                gpuProfiler.begin(PASS_FXAA);
 
                 glBindFramebuffer(GL_FRAMEBUFFER, 0);
                 glDisable(GL_DEPTH_TEST); // disable depth test so screen-space quad isn't discarded due to depth test.
@@ -1137,7 +1902,6 @@ int main()
                 glClear(GL_COLOR_BUFFER_BIT);
 
                 fxaaShader.use();
-                fxaaShader.setVec4("screenSize", glm::vec4(1.0f / SCR_WIDTH, 1.0f / SCR_HEIGHT, SCR_WIDTH, SCR_HEIGHT));
 
                 glBindVertexArray(quadVAO);
                 glActiveTexture(GL_TEXTURE0);
@@ -1145,89 +1909,72 @@ int main()
                 glDrawArrays(GL_TRIANGLES, 0, 6);
 
                 glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                gpuProfiler.end(PASS_FXAA);
             }
-            if (smaa) {
-
-                /* EDGE DETECTION PASS */
-                glBindFramebuffer(GL_FRAMEBUFFER, edgeFBO);
-                glDisable(GL_DEPTH_TEST);
-                // clear all relevant buffers
-                glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-                glClear(GL_COLOR_BUFFER_BIT);
-
-                smaaEdgeShader.use();
-                // set SMAA quality
-                smaaEdgeShader.setFloat("smaaThershold", smaaPresets[smaaPreset].threshold);
-                smaaEdgeShader.setFloat("smaaDepthThreshold", smaaPresets[smaaPreset].depthThreshold);
-                smaaEdgeShader.setInt("smaaMaxSearchSteps", smaaPresets[smaaPreset].maxSearchSteps);
-                smaaEdgeShader.setInt("smaaMaxSearchStepsDiag", smaaPresets[smaaPreset].maxSearchStepsDiag);
-                smaaEdgeShader.setInt("smaaCornerRounding", smaaPresets[smaaPreset].cornerRounding);
-                smaaEdgeShader.setVec4("screenSize", glm::vec4(1.0f / SCR_WIDTH, 1.0f / SCR_HEIGHT, SCR_WIDTH, SCR_HEIGHT));
-
-                glBindVertexArray(quadVAO);
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, colorTex);
-
-                glDrawArrays(GL_TRIANGLES, 0, 6);
-
-                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            if (smaa && !smaaCS) {
+                smaaPasses(0);
+            }
+            if (smaa && smaaCS) {
+                gpuProfiler.begin(PASS_SMAA_EDGE);
+                smaaCompute.detectEdges(smaaPreset, colorTex, edgeTex, SCR_WIDTH, SCR_HEIGHT);
+                gpuProfiler.end(PASS_SMAA_EDGE);
 
-                /* BLENDING WEIGHT PASS */
+                gpuProfiler.begin(PASS_SMAA_WEIGHT);
                 glBindFramebuffer(GL_FRAMEBUFFER, blendFBO);
-
-                // clear all relevant buffers
-                glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+                glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
                 glClear(GL_COLOR_BUFFER_BIT);
-
-                smaaWeightShader.use();
-                // set SMAA quality
-                smaaWeightShader.setFloat("smaaThershold", smaaPresets[smaaPreset].threshold);
-                smaaWeightShader.setFloat("smaaDepthThreshold", smaaPresets[smaaPreset].depthThreshold);
-                smaaWeightShader.setInt("smaaMaxSearchSteps", smaaPresets[smaaPreset].maxSearchSteps);
-                smaaWeightShader.setInt("smaaMaxSearchStepsDiag", smaaPresets[smaaPreset].maxSearchStepsDiag);
-                smaaWeightShader.setInt("smaaCornerRounding", smaaPresets[smaaPreset].cornerRounding);
-                smaaWeightShader.setVec4("screenSize", glm::vec4(1.0f / SCR_WIDTH, 1.0f / SCR_HEIGHT, SCR_WIDTH, SCR_HEIGHT));
-
-                glBindVertexArray(quadVAO);
-
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, edgeTex);
-                glActiveTexture(GL_TEXTURE1);
-                glBindTexture(GL_TEXTURE_2D, areaTex);
-                glActiveTexture(GL_TEXTURE2);
-                glBindTexture(GL_TEXTURE_2D, searchTex);
-
-                glDrawArrays(GL_TRIANGLES, 0, 6);
-
                 glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                smaaCompute.computeWeights(smaaPreset, edgeTex, areaTex, searchTex, blendTex);
+                gpuProfiler.end(PASS_SMAA_WEIGHT);
 
-                /*
-                /* NEIGHBORHOOD BLENDING PASS */
-                smaaBlendShader.use();
-                // set SMAA quality
-                smaaBlendShader.setFloat("smaaThershold", smaaPresets[smaaPreset].threshold);
-                smaaBlendShader.setFloat("smaaDepthThreshold", smaaPresets[smaaPreset].depthThreshold);
-                smaaBlendShader.setInt("smaaMaxSearchSteps", smaaPresets[smaaPreset].maxSearchSteps);
-                smaaBlendShader.setInt("smaaMaxSearchStepsDiag", smaaPresets[smaaPreset].maxSearchStepsDiag);
-                smaaBlendShader.setInt("smaaCornerRounding", smaaPresets[smaaPreset].cornerRounding);
-                smaaBlendShader.setVec4("screenSize", glm::vec4(1.0f / SCR_WIDTH, 1.0f / SCR_HEIGHT, SCR_WIDTH, SCR_HEIGHT));
+                gpuProfiler.begin(PASS_SMAA_BLEND);
+                smaaCompute.blend(colorTex, blendTex, currentTex, SCR_WIDTH, SCR_HEIGHT);
 
-                glBindVertexArray(quadVAO);
+                // the fragment version draws to the screen directly, an image can't be the screen
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, currentFBO);
+                glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+                glBlitFramebuffer(0, 0, SCR_WIDTH, SCR_HEIGHT, 0, 0, SCR_WIDTH, SCR_HEIGHT, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                gpuProfiler.end(PASS_SMAA_BLEND);
+            }
+        }
 
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, colorTex);
-                glActiveTexture(GL_TEXTURE1);
-                glBindTexture(GL_TEXTURE_2D, blendTex);
 
-                glDrawArrays(GL_TRIANGLES, 0, 6);
+        frameTimer.end();
 
-                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        // read back the frame for its quality score or a capture; nothing here waits for the GPU
+        bool scoreThisFrame = benchmarkRunning && !referencesOnly && benchmarkSettings.referenceScale > 0
+            && qualityReferenceValid && benchmarkFrame >= benchmarkSettings.warmupFrames;
+        if (scoreThisFrame || captureRequested)
+        {
+            if (frameReadback.frameWidth() != (int)SCR_WIDTH || frameReadback.frameHeight() != (int)SCR_HEIGHT)
+                frameReadback.init((int)SCR_WIDTH, (int)SCR_HEIGHT);
+            if (benchmarkFrame == benchmarkSettings.warmupFrames)
+                frameReadback.resetDropped();
+            if (frameReadback.valid())
+            {
+                // a capture asked for while the frames are scored goes with the score; it stays
+                // requested until a frame was actually read for it
+                bool captured = false;
+                if (scoreThisFrame && captureRequested)
+                    captured = frameReadback.capture(0, frameNumber, [&](unsigned int frame, const RGBAImage& image) {
+                        scoreFrame(frame, image);
+                        saveCapture(frame, image);
+                    });
+                else if (scoreThisFrame)
+                    frameReadback.capture(0, frameNumber, scoreFrame);
+                else
+                    captured = frameReadback.capture(0, frameNumber, saveCapture);
+                if (captured)
+                    captureRequested = false;
             }
+            else
+                captureRequested = false;
         }
-
+        frameReadback.collect();
 
         /* ----- Render detail image where cursor located ----- */
-        if (detailScreen) {
+        if (detailScreen && !headless) {
             unsigned int viewportSize = 300;
             unsigned int viewportBeginX = SCR_WIDTH - 360;
             unsigned int viewportBeginY = SCR_HEIGHT - 360;
@@ -1296,10 +2043,13 @@ int main()
 
         }
 
-        ImGui::Render();
+        if (!headless)
+        {
+            ImGui::Render();
 
-        // Render dear imgui into screen
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+            // Render dear imgui into screen
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        }
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
@@ -1308,11 +2058,107 @@ int main()
         glViewport(0, 0, display_w, display_h);
         glfwSwapBuffers(window);
         glfwPollEvents();
+
+        // --references: only the ground truth of every cell, rendered above, nothing is measured
+        if (benchmarkRunning && referencesOnly)
+        {
+            if (++benchmarkConfigIndex == benchmarkSettings.configs.size())
+            {
+                benchmarkRunning = false;
+                glfwSetWindowShouldClose(window, true);
+            }
+        }
+        // benchmark: write the record of the cell after warmup + a fixed number of frames
+        else if (benchmarkRunning && ++benchmarkFrame == benchmarkSettings.warmupFrames + benchmarkSettings.frames)
+        {
+            glFinish();
+            frameTimes.setCpu(frameNumber, (glfwGetTime() - frameStartTime) * 1000.0);
+            while (frameTimer.read(timedFrame, gpuMs, true))
+                frameTimes.setGpu(timedFrame, gpuMs);
+            gpuProfiler.collect(true);
+
+            BenchmarkRecord record;
+            record.config = benchmarkSettings.configs[benchmarkConfigIndex];
+            record.warmupFrames = benchmarkSettings.warmupFrames;
+            record.frames = benchmarkSettings.frames;
+            record.elapsed = glfwGetTime() - benchmarkStartTime;
+            record.cpu = frameTimes.cpuStats();
+            record.gpu = frameTimes.gpuStats();
+            for (int pass = 0; pass < GPU_PASS_COUNT; pass++)
+                record.passMs[pass] = gpuProfiler.average((GpuPass)pass);
+            if (benchmarkSettings.referenceScale > 0)
+            {
+                // the frames still in flight, then the average over every frame scored
+                frameReadback.finish();
+                std::lock_guard<std::mutex> lock(qualityMutex);
+                if (qualityFrames > 0)
+                {
+                    record.quality.psnr = qualitySum.psnr / qualityFrames;
+                    record.quality.ssim = qualitySum.ssim / qualityFrames;
+                    record.quality.edgeError = qualitySum.edgeError / qualityFrames;
+                }
+                record.qualityFrames = qualityFrames;
+                record.qualityMeasured = qualityFrames > 0;     // "-" in the record without a reference
+                if (frameReadback.dropped() > 0)
+                    std::cout << frameReadback.dropped() << " frames were not scored, the metrics fell behind" << std::endl;
+                qualitySum = ImageQuality();
+                qualityFrames = 0;
+            }
+            writeBenchmarkRecord(benchmarkFile, record);
+            writeBenchmarkHistogram(benchmarkHistogramFile, record);
+
+            std::stringstream fpsStream, msStream;
+            fpsStream << std::fixed << std::setprecision(1) << record.frames / record.elapsed;
+            msStream << std::fixed << std::setprecision(3) << (record.elapsed / record.frames) * 1000;
+            std::cout << benchmarkSceneNames[record.config.scene] << " " << record.config.viewpoint << " "
+                << benchmarkConfigName(record.config) << ": " << fpsStream.str() << "FPS/ " << msStream.str() << "ms" << std::endl;
+            outputFile << "recorded " << record.frames << " frames : " << fpsStream.str() << "FPS/ " << msStream.str() << "ms" << std::endl;
+            writeFrameStatsSummary(outputFile, "CPU", record.cpu);
+            writeFrameStatsSummary(outputFile, "GPU", record.gpu);
+            writeGpuPassSummary(outputFile, record.passMs);
+            if (record.qualityMeasured)
+                writeQualitySummary(outputFile, record.quality, qualityReferenceScale, record.qualityFrames);
+
+            benchmarkFrame = 0;
+            if (++benchmarkConfigIndex == benchmarkSettings.configs.size())
+            {
+                benchmarkRunning = false;
+                if (headless)
+                    glfwSetWindowShouldClose(window, true);
+            }
+        }
+
+        // "Benchmark(10s)": summarize every frame of the last 10 seconds
+        if (interactiveBenchmarkEnd > 0.0 && glfwGetTime() >= interactiveBenchmarkEnd)
+        {
+            outputFile << "recorded frame times for 10s" << std::endl;
+            writeFrameStatsSummary(outputFile, "CPU", frameTimes.cpuStats());
+            writeFrameStatsSummary(outputFile, "GPU", frameTimes.gpuStats());
+            gpuProfiler.collect(false);
+            double passMs[GPU_PASS_COUNT];
+            for (int pass = 0; pass < GPU_PASS_COUNT; pass++)
+                passMs[pass] = gpuProfiler.average((GpuPass)pass);
+            writeGpuPassSummary(outputFile, passMs);
+            interactiveBenchmarkEnd = 0.0;
+        }
+
+        frameNumber++;
     }
 
+    frameTimer.release();
+    gpuProfiler.release();
+    frameReadback.release();
+
     // Cleanup
+    textureStreamer.finish();
+    container.batch.release();
+    sponza.batch.release();
+    uploadRing.release();
     glDeleteVertexArrays(1, &quadVAO);
     glDeleteBuffers(1, &quadVBO);
+    glDeleteBuffers(1, &postProcessUBO);
+    msaaTargets.release();
+    smaaCompute.release();
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -1337,47 +2183,23 @@ void processInput(GLFWwindow* window)
         glfwSetWindowShouldClose(window, true);
 
     if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
-        if (taa && wasTAAOn) {
-            wasTAAOn = false;
-            temporalAAFirstFrame = true;
-        }
         camera.ProcessKeyboard(FORWARD, deltaTime);
     }
     if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
-        if (taa && wasTAAOn) {
-            wasTAAOn = false;
-            temporalAAFirstFrame = true;
-        }
         camera.ProcessKeyboard(BACKWARD, deltaTime);
     }
     if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
-        if (taa && wasTAAOn) {
-            wasTAAOn = false;
-            temporalAAFirstFrame = true;
-        }
         camera.ProcessKeyboard(LEFT, deltaTime);
     }
     if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
-        if (taa && wasTAAOn) {
-            wasTAAOn = false;
-            temporalAAFirstFrame = true;
-        }
         camera.ProcessKeyboard(RIGHT, deltaTime);
     }
 
     float velocity = deltaTime * 5.0f;
     if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS) {
-        if (taa && wasTAAOn) {
-            wasTAAOn = false;
-            temporalAAFirstFrame = true;
-        }
         camera.Position += camera.Up * velocity;
     }
     if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS) {
-        if (taa && wasTAAOn) {
-            wasTAAOn = false;
-            temporalAAFirstFrame = true;
-        }
         camera.Position -= camera.Up * velocity;
     }
 }
@@ -1394,8 +2216,6 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
     {
         glBindTexture(GL_TEXTURE_2D, colorTex);
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-        glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, multiSamplingTex);
-        glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, msaaSamples[msaaQualityLevel], GL_RGB, SCR_WIDTH, SCR_HEIGHT, GL_TRUE);
         glBindTexture(GL_TEXTURE_2D, edgeTex);
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
         glBindTexture(GL_TEXTURE_2D, blendTex);
@@ -1403,15 +2223,36 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 
         glBindTexture(GL_TEXTURE_2D, currentTex);
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-        glBindTexture(GL_TEXTURE_2D, previousTex);
+        for (int i = 0; i < 2; i++)
+        {
+            glBindTexture(GL_TEXTURE_2D, historyTex[i]);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
+        }
+        glBindTexture(GL_TEXTURE_2D, velocityTex);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RG, GL_FLOAT, NULL);
+
+        glBindTexture(GL_TEXTURE_2D, Subsample1);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glBindTexture(GL_TEXTURE_2D, Subsample2);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glBindTexture(GL_TEXTURE_2D, subsampleEdgeTex);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glBindTexture(GL_TEXTURE_2D, subsampleBlendTex);
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
 
-        glBindRenderbuffer(GL_RENDERBUFFER, multiSampledRBO);
-        glRenderbufferStorageMultisample(GL_RENDERBUFFER, msaaSamples[msaaQualityLevel], GL_DEPTH24_STENCIL8, SCR_WIDTH, SCR_HEIGHT);
-        glBindRenderbuffer(GL_RENDERBUFFER, colorRBO);
+        glBindTexture(GL_TEXTURE_2D, depthTex);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, SCR_WIDTH, SCR_HEIGHT, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, NULL);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glBindRenderbuffer(GL_RENDERBUFFER, smaaStencilRBO);
         glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, SCR_WIDTH, SCR_HEIGHT);
         glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        // the targets of the old size are of no use anymore
+        msaaTargets.evict(SCR_WIDTH, SCR_HEIGHT);
+        attachMSAATarget();
     }
+    updatePostProcessParameters();
 
 
     glViewport(0, 0, width, height);
@@ -1453,11 +2294,6 @@ void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
         return;
     }
 
-    if (taa && wasTAAOn) {
-        wasTAAOn = false;
-        temporalAAFirstFrame = true;
-    }
-
     camera.ProcessMouseMovement(xoffset, yoffset);
 }
 
@@ -1519,17 +2355,302 @@ void changeViewpoint(int view)
     }
 }
 
-void timeChecker(std::ofstream& outputFile, bool& benchActive)
+// set the AA state, scene and resolution the same way the Control Panel would
+// ---------------------------------------------------------------------------
+void applyBenchmarkConfig(GLFWwindow* window, const BenchmarkConfig& config)
+{
+    antiAliasing = config.method != AA_NONE;
+    msaa = config.method == AA_MSAA;
+    fxaa = config.method == AA_FXAA;
+    smaa = config.method == AA_SMAA || config.method == AA_SMAA_CS;
+    smaaCS = config.method == AA_SMAA_CS;
+    taa = antiAliasing && config.taa;
+    wasTAAOn = taa;
+    temporalAAFirstFrame = true;
+    taaJitterSequence = config.jitterSequence;
+    taaJitterSamples = config.jitterSamples;
+    smaaMode = config.smaaMode;
+    smaaEdgeMethod = config.smaaEdgeMethod;
+    temporalFrame = 0;
+    updatePostProcessParameters();
+
+    currentAA = config.method;
+    currentMSAAQuality = config.msaaQuality;
+    currentSMAAQuality = config.smaaQuality;
+    currentScene = config.scene;
+
+    if (config.width != (int)SCR_WIDTH || config.height != (int)SCR_HEIGHT)
+    {
+        glfwSetWindowSize(window, config.width, config.height);
+        framebuffer_size_callback(window, config.width, config.height);
+    }
+}
+
+// attach the render targets of the current MSAA quality (2x for SMAA S2x and 4x) and size,
+// created once per combination; the motion vectors only while TAA reads them
+// ---------------------------------------------------------------------------
+void attachMSAATarget()
+{
+    GLsizei samples = smaaModeSpatial(activeSMAAMode()) ? 2 : msaaSamples[msaaQualityLevel];
+    if (!msaaTargets.attach(multisampledFBO, samples, SCR_WIDTH, SCR_HEIGHT, GL_RGBA8, wasTAAOn) || samples != 2)
+        return;
+
+    // S2x needs to know which sample is S0 of the SMAA table, offset by (0.25, -0.25) with y up
+    GLfloat position[2];
+    glBindFramebuffer(GL_FRAMEBUFFER, multisampledFBO);
+    glGetMultisamplefv(GL_SAMPLE_POSITION, 0, position);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    smaaSampleOrderSwapped = position[0] < 0.5f;
+}
+
+// resolve the multisampled scene: the color into colorTex, the motion vectors into velocityTex
+// ---------------------------------------------------------------------------
+void resolveMSAATarget(bool color, bool velocity)
+{
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, multisampledFBO);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, colorFBO);
+
+    // a blit writes to every draw buffer, so the attachments are resolved one at a time
+    int attachments = velocity ? 2 : 1;
+    for (int i = color ? 0 : 1; i < attachments; i++)
+    {
+        glReadBuffer(sceneDrawBuffers[i]);
+        glDrawBuffer(sceneDrawBuffers[i]);
+        glBlitFramebuffer(0, 0, SCR_WIDTH, SCR_HEIGHT, 0, 0, SCR_WIDTH, SCR_HEIGHT, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    }
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+}
+
+// write the SMAA preset, screen metrics, predication and TAA settings to the uniform buffer
+// ---------------------------------------------------------------------------
+void updatePostProcessParameters()
+{
+    if (postProcessUBO == 0)
+        return; // resized before the buffer exists
+
+    PostProcessParameters parameters = {};
+    parameters.screenSize = glm::vec4(1.0f / SCR_WIDTH, 1.0f / SCR_HEIGHT, SCR_WIDTH, SCR_HEIGHT);
+    parameters.smaa = smaaPresets[smaaPreset];
+    parameters.predicationThreshold = 0.01f;
+    parameters.predicationScale = 2.0f;
+    parameters.predicationStrength = 0.4f;
+    parameters.reprojWeigthScale = reprojectionWeightScale;
+    parameters.taaCurrentWeight = taaCurrentWeight();
+    parameters.taaHistoryClamp = taaHistoryClamp ? 1 : 0;
+    postProcessTAAWeight = parameters.taaCurrentWeight;
+
+    glBindBuffer(GL_UNIFORM_BUFFER, postProcessUBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(parameters), &parameters);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+// the SMAA mode in effect: the modes are for the fragment path only, and T2x and 4x need TAA
+// ---------------------------------------------------------------------------
+int activeSMAAMode()
+{
+    if (!smaa || smaaCS)
+        return SMAA_MODE_1X;
+    if (smaaModeTemporal(smaaMode) && !(antiAliasing && wasTAAOn))
+        return smaaMode == SMAA_MODE_4X ? SMAA_MODE_S2X : SMAA_MODE_1X;
+    return smaaMode;
+}
+
+// the jitter of TAA, unless an SMAA mode dictates its own
+// ---------------------------------------------------------------------------
+int activeJitterSequence()
+{
+    int mode = activeSMAAMode();
+    return smaaModeTemporal(mode) ? smaaModeJitter(mode) : taaJitterSequence;
+}
+
+// weight of the current frame in the TAA history, the history converges over one jitter cycle
+// ---------------------------------------------------------------------------
+float taaCurrentWeight()
+{
+    return 1.0f / jitterSampleCount(activeJitterSequence(), taaJitterSamples);
+}
+
+// renders the image with fxaaShader and compares the result with the CPU reference; returns 0
+// if at most 0.1% of the pixels are off by more than 2 in a channel, which leaves room for the
+// filtering precision of the texture units
+// ---------------------------------------------------------------------------
+int validateCPUFXAA(const char* path, int cpuPath, Shader& fxaaShader)
+{
+    RGBAImage source;
+    if (!loadRGBAImage(path, source))
+        return 1;
+
+    GLuint textures[2];
+    glGenTextures(2, textures);
+    for (int i = 0; i < 2; i++)
+    {
+        glBindTexture(GL_TEXTURE_2D, textures[i]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, source.width, source.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, i == 0 ? source.pixels.data() : NULL);
+    }
+    GLuint fbo;
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[1], 0);
+
+    // the shader reads the frame size from the parameter block, which holds the window's
+    glm::vec4 screenSize(1.0f / source.width, 1.0f / source.height, source.width, source.height);
+    glBindBuffer(GL_UNIFORM_BUFFER, postProcessUBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(screenSize), &screenSize);
+    glBindBufferBase(GL_UNIFORM_BUFFER, 0, postProcessUBO);
+
+    glViewport(0, 0, source.width, source.height);
+    glDisable(GL_DEPTH_TEST);
+    fxaaShader.use();
+    glBindVertexArray(quadVAO);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, textures[0]);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+
+    RGBAImage gpu;
+    gpu.resize(source.width, source.height);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, source.width, source.height, GL_RGBA, GL_UNSIGNED_BYTE, gpu.pixels.data());
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteTextures(2, textures);
+    glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+    updatePostProcessParameters();
+
+    RGBAImage cpu;
+    cpuPath = fxaaCpu(source, cpu, cpuPath);
+    ImageDifference difference = compareImages(cpu, gpu, 2);
+    size_t allowed = (size_t)source.width * source.height / 1000;
+    bool passed = difference.pixelsOver <= allowed;
+
+    std::cout << "FXAA " << fxaaCpuPathNames[cpuPath] << " vs GPU on " << path << ": max difference " << difference.maxDifference
+        << " at (" << difference.maxX << ", " << difference.maxY << "), mean " << difference.meanDifference
+        << ", " << difference.pixelsOver << " pixels off by more than 2 (" << allowed << " allowed): "
+        << (passed ? "PASSED" : "FAILED") << std::endl;
+    return passed ? 0 : 1;
+}
+
+// runs the luma edge detection, blending weight and neighborhood blending programs of the preset
+// on the image and compares every pass with SMAACpu. The edges have to match exactly; for the
+// weights and the result at most 0.1% of the pixels may be off by more than 2 in a channel,
+// the texture units filter AreaTex and the color with less precision than the CPU.
+// ---------------------------------------------------------------------------
+int validateCPUSMAA(const char* path, int preset, Shader& edgeShader, Shader& weightShader, Shader& blendShader)
 {
-    std::cout << "timer set" << std::endl;
-    outputFile << "start benchmarking" << std::endl;
-    int targetTimeSeconds = 10;
+    RGBAImage source;
+    if (!loadRGBAImage(path, source))
+        return 1;
 
-    std::chrono::seconds waitTime(targetTimeSeconds);
+    // color, edges, weights, result
+    GLuint textures[4];
+    GLuint fbos[3];
+    glGenTextures(4, textures);
+    glGenFramebuffers(3, fbos);
+    for (int i = 0; i < 4; i++)
+    {
+        glBindTexture(GL_TEXTURE_2D, textures[i]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, source.width, source.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, i == 0 ? source.pixels.data() : NULL);
+        if (i > 0)
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, fbos[i - 1]);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[i], 0);
+        }
+    }
 
-    std::this_thread::sleep_for(waitTime);
-    outputFile << "recorded fps for 10s" << std::endl;
+    glm::vec4 screenSize(1.0f / source.width, 1.0f / source.height, source.width, source.height);
+    glBindBuffer(GL_UNIFORM_BUFFER, postProcessUBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(screenSize), &screenSize);
+    glBindBufferBase(GL_UNIFORM_BUFFER, 0, postProcessUBO);
+
+    glViewport(0, 0, source.width, source.height);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_STENCIL_TEST);
+    glBindVertexArray(quadVAO);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    RGBAImage gpu[3];
+
+    // edges: the shader discards the pixels without one, so they keep the clear color. Without
+    // the stencil test the weight pass runs everywhere, pixels without edges get 0 anyway.
+    glBindFramebuffer(GL_FRAMEBUFFER, fbos[0]);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    edgeShader.use();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, textures[0]);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, fbos[1]);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    weightShader.use();
+    weightShader.setVec4("subsampleIndices", glm::vec4(0.0f));
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, textures[1]);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, areaTex);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, searchTex);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
 
-    benchActive = false;
-    std::cout << "timer ended" << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, fbos[2]);
+    blendShader.use();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, textures[0]);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, textures[2]);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+
+    for (int i = 0; i < 3; i++)
+    {
+        gpu[i].resize(source.width, source.height);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbos[i]);
+        glReadPixels(0, 0, source.width, source.height, GL_RGBA, GL_UNSIGNED_BYTE, gpu[i].pixels.data());
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glDeleteFramebuffers(3, fbos);
+    glDeleteTextures(4, textures);
+    glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+    updatePostProcessParameters();
+
+    RGBAImage cpu[3];
+    SMAACpu smaa;
+    smaa.run(source, cpu[2], smaaCpuPresets[preset]);
+    smaa.edgeImage(cpu[0]);
+    smaa.weightImage(cpu[1]);
+
+    // edges in r and g, all four weight channels
+    size_t edgeMismatches = 0;
+    size_t weightsOver = 0;
+    int maxWeightDifference = 0;
+    for (size_t i = 0; i < gpu[0].pixels.size(); i += 4)
+    {
+        if (cpu[0].pixels[i] != gpu[0].pixels[i] || cpu[0].pixels[i + 1] != gpu[0].pixels[i + 1])
+            edgeMismatches++;
+        int pixelMax = 0;
+        for (int c = 0; c < 4; c++)
+            pixelMax = std::max(pixelMax, std::abs(cpu[1].pixels[i + c] - gpu[1].pixels[i + c]));
+        if (pixelMax > 2)
+            weightsOver++;
+        maxWeightDifference = std::max(maxWeightDifference, pixelMax);
+    }
+    ImageDifference difference = compareImages(cpu[2], gpu[2], 2);
+    size_t allowed = (size_t)source.width * source.height / 1000;
+    bool passed = edgeMismatches == 0 && weightsOver <= allowed && difference.pixelsOver <= allowed;
+
+    std::cout << "SMAA " << benchmarkSMAANames[preset] << " CPU vs GPU on " << path << ": " << edgeMismatches << " edge pixels differ, "
+        << "weights max difference " << maxWeightDifference << " with " << weightsOver << " pixels off by more than 2, "
+        << "result max difference " << difference.maxDifference << " at (" << difference.maxX << ", " << difference.maxY << "), mean "
+        << difference.meanDifference << ", " << difference.pixelsOver << " pixels off by more than 2 (" << allowed << " allowed): "
+        << (passed ? "PASSED" : "FAILED") << std::endl;
+    return passed ? 0 : 1;
 }